@@ -11,7 +11,20 @@
 
 typedef double (*PlaySoundFunction) (int,unsigned int,double);
 
-typedef double (*GenSoundFunction) (double, double, double, PlaySoundFunction);
+typedef double (*GenSoundFunction) (double, double, double);
+
+/*
+    Read-only view of a decoded sound passed to the generated library.
+    Layout must match SoundDescriptor emitted into generated main.h.
+*/
+struct GenSoundDescriptor {
+    const qint32 *data;
+    unsigned int length;
+    double frequency;
+    unsigned int channels_count;
+};
+
+typedef void (*GenSoundInitFunction) (PlaySoundFunction, const GenSoundDescriptor*, unsigned int);
 
 struct GenSoundChannelInfo {
     double freq;
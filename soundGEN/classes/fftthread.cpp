@@ -0,0 +1,206 @@
+#include "fftthread.h"
+
+/* weight of the newest spectrum in exponential averaging */
+const double FftThread::exponential_k = 0.25;
+
+FftThread::FftThread(QObject *parent) :
+    QThread(parent)
+{
+    analyzer = new SndAnalyzer();
+    analyzer->setTop_harmonic(5);
+    analyzer->setAmp_filter(0.0001);
+    analyzer->setGroup_peaks(true);
+    analyzer->setWindow(SndWindowHann);
+    analyzer->setInterpolation(SndInterpolationGaussian);
+    average_mode = FftAverageNone;
+    has_request = busy = stop = reset_average = false;
+    pending_slot = 0;
+
+    /* frames 0 and 1 are handed to the surface by attachFrames */
+    ready_frame.storeRelease(2);
+    back_frame = 3;
+}
+
+FftThread::~FftThread()
+{
+    mutex.lock();
+    stop = true;
+    has_request = false;
+    wake.wakeAll();
+    mutex.unlock();
+    wait();
+    delete analyzer;
+}
+
+/*
+    Takes points frames of the channel from position, or the newest ones if those
+    aren't rendered yet. Returns false if the tap doesn't hold enough samples.
+*/
+bool FftThread::request(const SndRingBuffer *tap, unsigned int channel, quint32 position, unsigned int points, double frequency)
+{
+    QMutexLocker locker(&mutex);
+    QVector<float> &slot = sample_slots[pending_slot];
+    /* with reserved capacity a shorter request doesn't release the memory */
+    if (slot.capacity()<(int) points) slot.reserve(points);
+    slot.resize(points);
+    if (!tap->read(channel, position, slot.data(), points) && !tap->readLatest(channel, slot.data(), points)) {
+        return false;
+    }
+
+    next_request.points = points;
+    next_request.frequency = frequency;
+    has_request = true;
+    if (!isRunning()) start(QThread::LowPriority);
+    wake.wakeOne();
+    return true;
+}
+
+/*
+    Drops the pending request and blocks until a running transform is finished,
+    after that no spectrum of earlier requests is published anymore.
+*/
+void FftThread::cancel()
+{
+    QMutexLocker locker(&mutex);
+    has_request = false;
+    while (busy) {
+        idle.wait(&mutex);
+    }
+    /* the worker is idle, nobody else can publish now */
+    ready_frame.storeRelease(ready_frame.loadAcquire() & frame_index_mask);
+}
+
+void FftThread::attachFrames(FftFrame **current, FftFrame **next)
+{
+    *current = &frames[0];
+    *next = &frames[1];
+}
+
+/*
+    Gives the frame back to the worker and returns the newest spectrum in it,
+    if there is one that the surface hasn't taken yet.
+*/
+bool FftThread::takeResult(FftFrame **frame)
+{
+    if (!(ready_frame.loadAcquire() & frame_fresh)) return false;
+    int index = *frame - frames;
+    *frame = &frames[ready_frame.fetchAndStoreOrdered(index) & frame_index_mask];
+    return true;
+}
+
+static void copy_harmonics(const QVector<HarmonicInfo> *src, QVector<HarmonicInfo> *dest)
+{
+    if (!src) {
+        dest->resize(0);
+        return;
+    }
+    /* with reserved capacity a smaller spectrum doesn't release the memory */
+    if (dest->capacity()<src->size()) dest->reserve(src->size());
+    dest->resize(src->size());
+    if (!src->isEmpty()) {
+        memcpy(dest->data(), src->constData(), src->size()*sizeof(HarmonicInfo));
+    }
+}
+
+void FftThread::publish()
+{
+    FftFrame *frame = &frames[back_frame];
+    copy_harmonics(analyzer->getHarmonics(), &frame->harmonics);
+    copy_harmonics(analyzer->getTopHarmonics(), &frame->top);
+    back_frame = ready_frame.fetchAndStoreOrdered(back_frame | frame_fresh) & frame_index_mask;
+}
+
+MFftAverageMode FftThread::getAverageMode() const
+{
+    return average_mode;
+}
+
+void FftThread::setAverageMode(MFftAverageMode value)
+{
+    QMutexLocker locker(&mutex);
+    if (average_mode!=value) {
+        average_mode = value;
+        reset_average = true;
+    }
+}
+
+void FftThread::resetAverage()
+{
+    QMutexLocker locker(&mutex);
+    reset_average = true;
+}
+
+void FftThread::run()
+{
+    FftRequest r;
+    MFftAverageMode mode;
+    int slot;
+
+    mutex.lock();
+    while (!stop) {
+        if (!has_request) {
+            wake.wait(&mutex);
+            continue;
+        }
+        r = next_request;
+        slot = pending_slot;
+        pending_slot = 1-pending_slot;
+        mode = average_mode;
+        has_request = false;
+        busy = true;
+        if (reset_average) {
+            averaged.clear();
+            analyzer->clearHarmonics();
+            reset_average = false;
+        }
+        mutex.unlock();
+
+        calcSpectrum(sample_slots[slot].constData(), r, mode);
+
+        publish();
+
+        mutex.lock();
+        busy = false;
+        idle.wakeAll();
+        mutex.unlock();
+
+        emit ready();
+
+        mutex.lock();
+    }
+    mutex.unlock();
+}
+
+void FftThread::calcSpectrum(const float *samples, const FftRequest &r, MFftAverageMode mode)
+{
+    unsigned int i;
+
+    if (mode==FftAverageNone) {
+        analyzer->samples_fft_base(samples, r.points, r.frequency);
+        return;
+    }
+
+    analyzer->samples_psd_welch(samples, r.points, welch_segment, r.frequency);
+    if (mode==FftAverageWelch) return;
+
+    QVector<HarmonicInfo> *harmonics = analyzer->getHarmonics();
+    if (averaged.size()!=harmonics->size()) {
+        averaged.resize(harmonics->size());
+        for(i = 0; i<(unsigned int) harmonics->size(); i++) {
+            averaged[i] = harmonics->at(i).amp;
+        }
+    }
+
+    HarmonicInfo *h = harmonics->data();
+    double *a = averaged.data();
+    for(i = 0; i<(unsigned int) averaged.size(); i++) {
+        if (mode==FftAverageExponential) {
+            a[i] += exponential_k*(h[i].amp - a[i]);
+        } else if (h[i].amp>a[i]) {
+            a[i] = h[i].amp;
+        }
+        h[i].amp = a[i];
+    }
+    /* the top harmonics of the single Welch pass don't match the averaged curve */
+    analyzer->recalcTopHarmonics();
+}
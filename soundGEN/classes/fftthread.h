@@ -0,0 +1,88 @@
+#ifndef FFTTHREAD_H
+#define FFTTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QAtomicInt>
+#include "sndanalyzer.h"
+#include "sndringbuffer.h"
+
+/*
+    FftAverageNone: one transform over the whole interval.
+    FftAverageWelch: averaged power of short overlapped segments of the interval.
+    FftAverageExponential, FftAveragePeakHold: Welch spectra combined over successive intervals.
+*/
+enum MFftAverageMode { FftAverageNone, FftAverageWelch, FftAverageExponential, FftAveragePeakHold };
+
+struct FftRequest {
+    unsigned int points;
+    double frequency;
+};
+
+struct FftFrame {
+    QVector<HarmonicInfo> harmonics;
+    QVector<HarmonicInfo> top;
+};
+
+/*
+    Computes spectra of rendered samples away from the GUI thread. Only the newest
+    request is kept.
+
+    Request samples are copied from the tap into one of two sample slots owned by the
+    worker: the pending slot is filled under the mutex, the worker exchanges it with
+    its working slot when it takes the request. Slots only grow, so steady requests
+    don't allocate.
+
+    Spectra are passed in a fixed set of frames that are never reallocated once they
+    have grown to the spectrum size: the worker fills its back frame and exchanges
+    it with the ready slot, the surface exchanges a frame it no longer needs with
+    the ready slot when that holds a fresh spectrum. The surface keeps two frames
+    (current and next interval), so there are four frames in total.
+*/
+class FftThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit FftThread(QObject *parent = 0);
+    ~FftThread();
+
+    bool request(const SndRingBuffer *tap, unsigned int channel, quint32 position, unsigned int points, double frequency);
+    void cancel();
+    void attachFrames(FftFrame **current, FftFrame **next);
+    bool takeResult(FftFrame **frame);
+
+    MFftAverageMode getAverageMode() const;
+    void setAverageMode(MFftAverageMode value);
+    void resetAverage();
+protected:
+    void run();
+private:
+    static const unsigned int welch_segment = 8192;
+    static const int frames_count = 4;
+    static const int frame_index_mask = 7;
+    static const int frame_fresh = 8;
+    static const double exponential_k;
+    SndAnalyzer *analyzer;
+    MFftAverageMode average_mode;
+    QVector<double> averaged;
+
+    QMutex mutex;
+    QWaitCondition wake, idle;
+    FftRequest next_request;
+    bool has_request, busy, stop, reset_average;
+    QVector<float> sample_slots[2];
+    int pending_slot;
+
+    FftFrame frames[frames_count];
+    int back_frame;
+    /* index of the ready frame, with frame_fresh set until the surface takes it */
+    QAtomicInt ready_frame;
+    void calcSpectrum(const float *samples, const FftRequest &r, MFftAverageMode mode);
+    void publish();
+signals:
+    void ready();
+};
+
+#endif // FFTTHREAD_H
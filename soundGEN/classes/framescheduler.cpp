@@ -0,0 +1,141 @@
+#include "framescheduler.h"
+
+FrameScheduler* FrameScheduler::_self_scheduler = 0;
+
+FrameScheduler::FrameScheduler(QObject *parent) :
+    QObject(parent)
+{
+    interval = 30;
+    next_frame = 0;
+    report_start = 0;
+    frames_count = dropped_frames = report_dropped = 0;
+
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    connect(timer, SIGNAL(timeout()), this, SLOT(frame()));
+    clock.start();
+}
+
+FrameScheduler::~FrameScheduler()
+{
+    timer->stop();
+}
+
+FrameScheduler *FrameScheduler::Instance()
+{
+    if(!_self_scheduler)
+    {
+        _self_scheduler = new FrameScheduler();
+    }
+    return _self_scheduler;
+}
+
+bool FrameScheduler::DeleteInstance()
+{
+    if(_self_scheduler)
+    {
+        delete _self_scheduler;
+        _self_scheduler = 0;
+        return true;
+    }
+    return false;
+}
+
+void FrameScheduler::addClient(FrameSchedulerClient *client)
+{
+    if (!clients.contains(client)) clients.append(client);
+}
+
+void FrameScheduler::removeClient(FrameSchedulerClient *client)
+{
+    clients.removeAll(client);
+}
+
+int FrameScheduler::getInterval() const
+{
+    return (int) interval;
+}
+
+int FrameScheduler::getDroppedFrames() const
+{
+    return dropped_frames;
+}
+
+void FrameScheduler::scheduleFrame(qint64 at)
+{
+    next_frame = at;
+    timer->start((int) qMax((qint64) 0, at-clock.elapsed()));
+}
+
+/*
+    Any number of requests before the next tick result in one frame, an idle
+    scheduler starts right away but never earlier than the current interval allows.
+*/
+void FrameScheduler::requestFrame()
+{
+    if (timer->isActive()) return;
+    scheduleFrame(qMax(clock.elapsed(), next_frame));
+}
+
+void FrameScheduler::frame()
+{
+    qint64 start = clock.elapsed();
+    qint64 late = start-next_frame;
+    bool active = false, visible = false;
+    int i;
+
+    if (frames_count==0) {
+        report_start = start;
+        late = 0;
+    }
+
+    /* a tick later than a whole interval means frames that were never shown */
+    if (late>=interval) {
+        int dropped = (int) (late/interval);
+        dropped_frames += dropped;
+        report_dropped += dropped;
+    }
+
+    for(i = 0; i<clients.size(); i++) {
+        if (!clients.at(i)->frameActive()) continue;
+        active = true;
+        if (clients.at(i)->frameVisible()) {
+            if (clients.at(i)->frameNeeded()) clients.at(i)->frameStep();
+            visible = true;
+        }
+    }
+
+    if (!active) {
+        /* nothing to animate: stay idle until the next request */
+        frames_count = 0;
+        next_frame = start;
+        return;
+    }
+    if (!visible) {
+        /* e.g. minimized window, only look again if something became visible */
+        frames_count = 0;
+        scheduleFrame(start+max_interval);
+        return;
+    }
+    frames_count++;
+
+    /*
+        The load is the time spent in this step plus the delay of the tick, which is
+        time the event loop needed for painting and everything else.
+    */
+    qint64 end = clock.elapsed();
+    double load = (end-start) + qMax((qint64) 0, late);
+    if (load>0.5*interval) {
+        interval = qMin(interval*1.25, (double) max_interval);
+    } else if (load<0.25*interval) {
+        interval = qMax(interval*0.95, (double) min_interval);
+    }
+
+    if (end-report_start>=report_interval) {
+        if (report_dropped>0) emit framesDropped(report_dropped, (int) interval);
+        report_dropped = 0;
+        report_start = end;
+    }
+
+    scheduleFrame(qMax(start+(qint64) interval, end));
+}
@@ -0,0 +1,66 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QList>
+#include <QElapsedTimer>
+
+class FrameSchedulerClient
+{
+public:
+    virtual ~FrameSchedulerClient() {}
+    /* true while the client is animated, e.g. during playback */
+    virtual bool frameActive() = 0;
+    /* true if an active client has something new to draw */
+    virtual bool frameNeeded() = 0;
+    /* hidden clients are skipped, but keep the scheduler polling at a low rate */
+    virtual bool frameVisible() = 0;
+    virtual void frameStep() = 0;
+};
+
+/*
+    Drives all graphic drawers from one single-shot timer in the GUI thread.
+    Requests are coalesced into one frame, hidden clients and clients with nothing
+    new to draw are skipped, and the timer isn't restarted while no client is active.
+    The interval grows while frames come late or take long and shrinks back
+    when there is time left; late ticks are counted as dropped frames.
+*/
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+private:
+    static FrameScheduler* _self_scheduler;
+    explicit FrameScheduler(QObject *parent = 0);
+    ~FrameScheduler();
+
+    Q_DISABLE_COPY(FrameScheduler);
+
+    static const int min_interval = 16;
+    static const int max_interval = 100;
+    static const int report_interval = 1000;
+
+    QList<FrameSchedulerClient*> clients;
+    QTimer *timer;
+    QElapsedTimer clock;
+    double interval;
+    qint64 next_frame, report_start;
+    int frames_count, dropped_frames, report_dropped;
+    void scheduleFrame(qint64 at);
+public:
+    static FrameScheduler* Instance();
+    static bool DeleteInstance();
+
+    void addClient(FrameSchedulerClient *client);
+    void removeClient(FrameSchedulerClient *client);
+    void requestFrame();
+
+    int getInterval() const;
+    int getDroppedFrames() const;
+signals:
+    void framesDropped(int count, int interval);
+private slots:
+    void frame();
+};
+
+#endif // FRAMESCHEDULER_H
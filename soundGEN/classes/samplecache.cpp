@@ -0,0 +1,164 @@
+#include "samplecache.h"
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(_WIN64)
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+static const char sample_cache_magic[4] = {'S','G','P','C'};
+static const quint32 sample_cache_version = 1;
+static const char sample_cache_format[] = "pcm32";
+/* total size of cached samples, least recently used files are removed beyond it */
+static const qint64 sample_cache_limit = (qint64) 1024*1024*1024;
+/* temporary files older than this are leftovers of interrupted stores */
+static const int sample_cache_tmp_age = 24*60*60;
+
+QString SampleCache::getCachePath()
+{
+    return EnvironmentInfo::getConfigsPath()+"/cache";
+}
+
+QString SampleCache::getKey(QString sound_file)
+{
+    QFile file(sound_file);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return "";
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(sample_cache_format, sizeof(sample_cache_format));
+    hash.addData(QByteArray::number(sample_cache_version));
+    while (!file.atEnd()) {
+        hash.addData(file.read(1 << 20));
+    }
+    file.close();
+
+    return hash.result().toHex();
+}
+
+QFile *SampleCache::load(QString key, qint32 **pcmData, unsigned int *samples_count, unsigned int *channels_count, double *frequency)
+{
+    if (key.isEmpty()) return 0;
+
+    QFile *cache_file = new QFile(getCachePath()+"/"+key+".pcm");
+    if (!cache_file->open(QIODevice::ReadOnly)) {
+        delete cache_file;
+        return 0;
+    }
+
+    SampleCacheHeader header;
+    if (cache_file->read((char*) &header, sizeof(header))!=sizeof(header)
+        || memcmp(header.magic, sample_cache_magic, sizeof(header.magic))!=0
+        || header.version!=sample_cache_version
+        || !header.channels_count || !header.samples_count
+        || cache_file->size()<(qint64) (sizeof(header) + (qint64) header.samples_count*sizeof(qint32)))
+    {
+        release(cache_file);
+        return 0;
+    }
+
+    /*
+        Read-only shared mapping: pages are backed by the cache file,
+        so several running instances share the same physical memory.
+    */
+    uchar *mapped = cache_file->map(sizeof(header), (qint64) header.samples_count*sizeof(qint32));
+    if (!mapped) {
+        release(cache_file);
+        return 0;
+    }
+
+    *pcmData = (qint32*) mapped;
+    *samples_count = header.samples_count;
+    *channels_count = header.channels_count;
+    *frequency = header.frequency;
+
+    touch(cache_file->fileName());
+    return cache_file;
+}
+
+bool SampleCache::store(QString key, const qint32 *pcmData, unsigned int samples_count, unsigned int channels_count, double frequency)
+{
+    if (key.isEmpty() || !pcmData || !samples_count) return false;
+
+    QDir dir(EnvironmentInfo::getConfigsPath());
+    dir.mkdir("cache");
+
+    SampleCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, sample_cache_magic, sizeof(header.magic));
+    header.version = sample_cache_version;
+    header.channels_count = channels_count;
+    header.samples_count = samples_count;
+    header.frequency = frequency;
+
+    QString cache_name = getCachePath()+"/"+key+".pcm";
+    QString tmp_name = cache_name+"."+QString::number(QCoreApplication::applicationPid())+".tmp";
+
+    QFile file(tmp_name);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    qint64 data_size = (qint64) samples_count*sizeof(qint32);
+    bool written = file.write((const char*) &header, sizeof(header))==sizeof(header)
+                   && file.write((const char*) pcmData, data_size)==data_size;
+    file.close();
+
+    /*
+        Publish atomically: concurrent instances either see the complete file or none.
+        If another instance already stored the same key, its copy is kept.
+    */
+    if (!written || QFile::exists(cache_name) || !QFile::rename(tmp_name, cache_name)) {
+        QFile::remove(tmp_name);
+        written = written && QFile::exists(cache_name);
+    }
+
+    if (written) evict(cache_name);
+    return written;
+}
+
+/*
+    The modification time marks the last use: access times are often not
+    updated by the file system.
+*/
+void SampleCache::touch(QString file_name)
+{
+    utime(QFile::encodeName(file_name).constData(), 0);
+}
+
+/*
+    Removes the least recently used files until the cache fits sample_cache_limit.
+    Files mapped by a running instance can't be removed on Windows and are skipped.
+*/
+void SampleCache::evict(QString keep_name)
+{
+    QDir dir(getCachePath());
+    QDateTime now = QDateTime::currentDateTime();
+    QFileInfoList files;
+    QFileInfo info;
+    qint64 total = 0;
+    int i;
+
+    files = dir.entryInfoList(QStringList() << "*.tmp", QDir::Files);
+    for(i=0; i<files.size(); i++) {
+        info = files.at(i);
+        if (info.lastModified().secsTo(now)>sample_cache_tmp_age) QFile::remove(info.absoluteFilePath());
+    }
+
+    /* oldest first */
+    files = dir.entryInfoList(QStringList() << "*.pcm", QDir::Files, QDir::Time | QDir::Reversed);
+    for(i=0; i<files.size(); i++) total += files.at(i).size();
+
+    for(i=0; i<files.size() && total>sample_cache_limit; i++) {
+        info = files.at(i);
+        if (info.absoluteFilePath()==QFileInfo(keep_name).absoluteFilePath()) continue;
+        if (QFile::remove(info.absoluteFilePath())) total -= info.size();
+    }
+}
+
+void SampleCache::release(QFile *cache_file)
+{
+    if (cache_file) {
+        cache_file->close();
+        delete cache_file;
+    }
+}
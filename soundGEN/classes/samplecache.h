@@ -0,0 +1,40 @@
+#ifndef SAMPLECACHE_H
+#define SAMPLECACHE_H
+
+#include <string.h>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QString>
+#include <QCryptographicHash>
+#include <QCoreApplication>
+#include "environmentinfo.h"
+
+/*
+    Cache file layout: 64 bytes header followed by interleaved qint32 samples.
+    Header is padded to 64 bytes so mapped sample data stays aligned.
+*/
+struct SampleCacheHeader {
+    char magic[4];
+    quint32 version;
+    quint32 channels_count;
+    quint32 samples_count;
+    double frequency;
+    quint8 reserved[40];
+};
+
+class SampleCache
+{
+public:
+    static QString getCachePath();
+    static QString getKey(QString sound_file);
+    static QFile *load(QString key, qint32 **pcmData, unsigned int *samples_count, unsigned int *channels_count, double *frequency);
+    static bool store(QString key, const qint32 *pcmData, unsigned int samples_count, unsigned int channels_count, double frequency);
+    static void release(QFile *cache_file);
+private:
+    static void touch(QString file_name);
+    static void evict(QString keep_name);
+};
+
+#endif // SAMPLECACHE_H
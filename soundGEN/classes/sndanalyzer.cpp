@@ -3,103 +3,324 @@
 SndAnalyzer::SndAnalyzer()
 {
     top_harmonic = 4;
+    harmonics_nfft = 0;
+    harmonics_base_freq = 0;
     amp_filter = 0;
     skip_zero_frequency = true;
+    group_peaks = false;
+    fft_size = SndFftPadded;
+    window = window_coeffs_type = SndWindowRect;
+    interpolation = SndInterpolationNone;
+    window_gain = 1;
     harmonics = new QVector<HarmonicInfo>;
     top_harmonics = new QVector<HarmonicInfo>;
+    fft_in = 0;
+    fft_out = 0;
+    fft_buffer_size = 0;
+    bluestein = 0;
 }
 
 SndAnalyzer::~SndAnalyzer()
 {
+    clearPlans();
+    if (fft_in)  qFreeAligned(fft_in);
+    if (fft_out) qFreeAligned(fft_out);
+    if (bluestein) delete bluestein;
     delete harmonics;
     delete top_harmonics;
 }
 
-void SndAnalyzer::function_fft_top_only(GenSoundFunction fct, PlaySoundFunction pfct, double t1, double t2, double freq, unsigned int points)
+kiss_fftr_cfg SndAnalyzer::getPlan(unsigned int points)
+{
+    kiss_fftr_cfg plan = fft_plans.value(points, 0);
+
+    if (plan) {
+        fft_plans_usage.removeOne(points);
+    } else {
+        if (fft_plans.size()>=max_plans) {
+            unsigned int unused_points = fft_plans_usage.takeFirst();
+            kiss_fftr_free(fft_plans.take(unused_points));
+        }
+        plan = kiss_fftr_alloc(points,0,0,0);
+        fft_plans.insert(points, plan);
+    }
+    fft_plans_usage.append(points);
+
+    return plan;
+}
+
+void SndAnalyzer::clearPlans()
+{
+    foreach(kiss_fftr_cfg plan, fft_plans) {
+        kiss_fftr_free(plan);
+    }
+    fft_plans.clear();
+    fft_plans_usage.clear();
+    if (bluestein) {
+        delete bluestein;
+        bluestein = 0;
+    }
+}
+
+static unsigned int fft_max_radix(unsigned int n)
+{
+    unsigned int p, radix = 1;
+
+    for(p = 2; p*p<=n; p++) {
+        while (n%p==0) {
+            radix = p;
+            n /= p;
+        }
+    }
+    return n>1 ? qMax(radix, n) : radix;
+}
+
+unsigned int SndAnalyzer::getTransformSize(unsigned int points)
+{
+    if (fft_size==SndFftExact) return points;
+    return kiss_fftr_next_fast_size_real(points);
+}
+
+void SndAnalyzer::reserveBuffers(unsigned int points)
+{
+    if (points<=fft_buffer_size) return;
+
+    if (fft_in)  qFreeAligned(fft_in);
+    if (fft_out) qFreeAligned(fft_out);
+    fft_in  = (kiss_fft_scalar*) qMallocAligned(points*sizeof(kiss_fft_scalar), 32);
+    fft_out = (kiss_fft_cpx*) qMallocAligned((points/2+1)*sizeof(kiss_fft_cpx), 32);
+    fft_buffer_size = points;
+}
+
+unsigned int SndAnalyzer::function_fft_fill(GenSoundFunction fct, double t1, double t2, double freq, unsigned int points)
 {
     double t, dt;
     unsigned int i;
 
-    result_amp = result_freq = 0;
-
-    kiss_fft_cpx* cin = new kiss_fft_cpx[points];
-    kiss_fft_cpx* cout = new kiss_fft_cpx[points];
-    kiss_fft_cfg  kiss_fft_state;
-    kiss_fft_scalar zero;
-    memset(&zero,0,sizeof(zero) );
+    reserveBuffers(getTransformSize(points));
 
     dt = (t2-t1)/points;
     for(i = 0; i<points; i++) {
         t = t1 + dt*i;
-        cin[i].i = zero;
-        cin[i].r = fct(t, freq*2*M_PI, freq, pfct);
-        if (abs(cin[i].r)>result_amp) result_amp = abs(cin[i].r);
+        fft_in[i] = fct(t, freq*2*M_PI, freq);
     }
 
-    kiss_fft_state = kiss_fft_alloc(points,0,0,0);
-    kiss_fft(kiss_fft_state,cin,cout);
+    return function_fft_exec(points);
+}
 
-    function_fft_calc_top(cout, points, abs(t2-t1));
+unsigned int SndAnalyzer::samples_fft_fill(const float *samples, unsigned int points)
+{
+    reserveBuffers(getTransformSize(points));
+    for(unsigned int i = 0; i<points; i++) {
+        fft_in[i] = samples[i];
+    }
 
-    free(kiss_fft_state);
-    delete [] cin;
-    delete [] cout;
+    return function_fft_exec(points);
 }
 
-void SndAnalyzer::function_fft_base(GenSoundFunction fct, PlaySoundFunction pfct, double t1, double t2, double freq, unsigned int points)
+/*
+    Cosine-sum windows in the periodic form, w[n] = sum((-1)^k * a[k] * cos(2*pi*k*n/points)).
+    Amplitudes are divided by the coherent gain, so a windowed tone keeps its level.
+*/
+static const double window_hann[] = {0.5, 0.5};
+static const double window_blackman_harris[] = {0.35875, 0.48829, 0.14128, 0.01168};
+static const double window_flat_top[] = {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368};
+
+void SndAnalyzer::applyWindow(unsigned int points)
 {
-    double t, dt;
-    double timelen = abs(t2-t1);
-    unsigned int i, j, i_start, i_finish;
-    double base_freq = points / timelen;
+    unsigned int i, k, terms;
+    const double *a;
+
+    switch (window) {
+    case SndWindowHann:           a = window_hann; terms = 2; break;
+    case SndWindowBlackmanHarris: a = window_blackman_harris; terms = 4; break;
+    case SndWindowFlatTop:        a = window_flat_top; terms = 5; break;
+    default:
+        /* the cached coefficients no longer match window_gain */
+        window_coeffs_type = SndWindowRect;
+        window_gain = 1;
+        return;
+    }
 
-    i_start = 0;
-    i_finish = points - 1;
+    if (window_coeffs_type!=window || (unsigned int) window_coeffs.size()!=points) {
+        double w, sum = 0;
+        window_coeffs.resize(points);
+        for(i = 0; i<points; i++) {
+            w = 0;
+            for(k = 0; k<terms; k++) {
+                w += (k%2 ? -a[k] : a[k]) * cos(2*M_PI*k*i/points);
+            }
+            window_coeffs[i] = w;
+            sum += w;
+        }
+        window_coeffs_type = window;
+        window_gain = sum/points;
+    }
 
-    if (skip_zero_frequency) {
-        i_start++;
-        i_finish--;
+    const kiss_fft_scalar *w = window_coeffs.constData();
+    for(i = 0; i<points; i++) {
+        fft_in[i] *= w[i];
+    }
+}
+
+/*
+    Transforms the first points values of fft_in and returns the transform size,
+    which defines the bin spacing of fft_out.
+*/
+unsigned int SndAnalyzer::function_fft_exec(unsigned int points)
+{
+    unsigned int i, nfft;
+
+    for(i = 0; i<points; i++) {
+        if (fabs(fft_in[i])>result_amp) result_amp = fabs(fft_in[i]);
+    }
+    applyWindow(points);
+
+    nfft = getTransformSize(points);
+    for(i = points; i<nfft; i++) {
+        fft_in[i] = 0;
+    }
+
+    if (nfft%2==0 && fft_max_radix(nfft/2)<=max_direct_radix) {
+        kiss_fftr(getPlan(nfft),fft_in,fft_out);
+    } else {
+        if (!bluestein || bluestein->getPoints()!=nfft) {
+            if (bluestein) delete bluestein;
+            bluestein = new SndBluestein(nfft);
+        }
+        bluestein->exec(fft_in, fft_out);
     }
 
+    return nfft;
+}
+
+void SndAnalyzer::function_fft_top_only(GenSoundFunction fct, double t1, double t2, double freq, unsigned int points)
+{
     result_amp = result_freq = 0;
+    if (points<2) return;
 
-    kiss_fft_cpx* cin = new kiss_fft_cpx[points];
-    kiss_fft_cpx* cout = new kiss_fft_cpx[points];
-    kiss_fft_cfg  kiss_fft_state;
-    kiss_fft_scalar zero;
-    memset(&zero,0,sizeof(zero) );
+    unsigned int nfft = function_fft_fill(fct, t1, t2, freq, points);
+    function_fft_calc_magnitudes(nfft, points/fabs(t2-t1));
+    function_fft_calc_top(nfft, points/fabs(t2-t1));
+}
 
-    dt = (t2-t1)/points;
+void SndAnalyzer::samples_fft_top_only(const float *samples, unsigned int points, double frequency)
+{
+    result_amp = result_freq = 0;
+    if (points<2) return;
+
+    unsigned int nfft = samples_fft_fill(samples, points);
+    function_fft_calc_magnitudes(nfft, frequency);
+    function_fft_calc_top(nfft, frequency);
+}
+
+void SndAnalyzer::function_fft_base(GenSoundFunction fct, double t1, double t2, double freq, unsigned int points)
+{
+    result_amp = result_freq = 0;
+    if (points<4) return;
+
+    function_fft_calc_harmonics(function_fft_fill(fct, t1, t2, freq, points), points / fabs(t2-t1));
+}
+
+void SndAnalyzer::samples_fft_base(const float *samples, unsigned int points, double frequency)
+{
+    result_amp = result_freq = 0;
+    if (points<4) return;
+
+    function_fft_calc_harmonics(samples_fft_fill(samples, points), frequency);
+}
+
+void SndAnalyzer::function_fft_calc_magnitudes(unsigned int nfft, double base_freq)
+{
+    unsigned int i, i_finish = nfft/2;
+    kiss_fft_cpx* cout = fft_out;
+
+    /* resizing to the same size keeps the vector storage, so no reallocation in steady state */
+    magnitudes.resize(i_finish+1);
+    double *mag = magnitudes.data();
+
+    for(i = 0; i<=i_finish; i++) {
+        mag[i] = sqrt(sqr(cout[i].r)+sqr(cout[i].i)) / (base_freq*window_gain);
+    }
+}
+
+void SndAnalyzer::function_fft_calc_harmonics(unsigned int nfft, double base_freq)
+{
+    function_fft_calc_magnitudes(nfft, base_freq);
+    function_fft_fill_harmonics(nfft, base_freq);
+}
+
+void SndAnalyzer::function_fft_fill_harmonics(unsigned int nfft, double base_freq)
+{
+    unsigned int i, i_start, i_finish;
+
+    i_start = skip_zero_frequency ? 1 : 0;
+    i_finish = nfft/2;
+
+    const double *mag = magnitudes.constData();
+    HarmonicInfo *tmp_info;
+
+    harmonics->resize(i_finish-i_start+1);
+    tmp_info = harmonics->data();
+    harmonics_nfft = nfft;
+    harmonics_base_freq = base_freq;
+
+    for(i = i_start; i<=i_finish; i++, tmp_info++) {
+        tmp_info->amp = mag[i];
+        tmp_info->freq = i*base_freq/nfft;
+    }
+
+    function_fft_calc_top(nfft, base_freq);
+}
+
+void SndAnalyzer::function_psd_welch(GenSoundFunction fct, double t1, double t2, double freq, unsigned int points, unsigned int segment_points)
+{
+    unsigned int i;
+    double dt = (t2-t1)/points;
+
+    welch_samples.resize(points);
+    float *samples = welch_samples.data();
     for(i = 0; i<points; i++) {
-        t = t1 + dt*i;
-        cin[i].i = zero;
-        cin[i].r = fct(t, freq*2*M_PI, freq, pfct);
-        if (abs(cin[i].r)>result_amp) result_amp = abs(cin[i].r);
+        samples[i] = fct(t1 + dt*i, freq*2*M_PI, freq);
     }
 
-    kiss_fft_state = kiss_fft_alloc(points,0,0,0);
-    kiss_fft(kiss_fft_state,cin,cout);
+    samples_psd_welch(samples, points, segment_points, points / fabs(t2-t1));
+}
 
-    double tmp_amp, tmp_amp2, tmp_freq;
-    HarmonicInfo tmp_info;
+/*
+    Welch method: power spectra of windowed segments with 50% overlap are averaged.
+    Amplitudes are the square root of the averaged power, in the scale of a single
+    segment_points transform, so they stay comparable with function_fft_base.
+*/
+void SndAnalyzer::samples_psd_welch(const float *samples, unsigned int points, unsigned int segment_points, double frequency)
+{
+    unsigned int i, s, nfft = 0, segments, hop;
 
-    harmonics->clear();
+    result_amp = result_freq = 0;
+    if (points<4) return;
 
-    for(i = i_start, j = i_finish; i<=j; i++, j--) {
-        tmp_amp = sqrt(sqr(cout[i].r)+sqr(cout[i].i)) / base_freq;
-        tmp_amp2 = sqrt(sqr(cout[j].r)+sqr(cout[j].i)) / base_freq;
-        if (tmp_amp<tmp_amp2) tmp_amp = tmp_amp2;
-        tmp_freq = i/timelen;
-        tmp_info.amp = tmp_amp;
-        tmp_info.freq = tmp_freq;
-        harmonics->append(tmp_info);
+    segment_points = qBound(4u, segment_points, points);
+    hop = qMax(segment_points/2, 1u);
+    segments = 1 + (points-segment_points)/hop;
+
+    for(s = 0; s<segments; s++) {
+        nfft = samples_fft_fill(samples + s*hop, segment_points);
+        function_fft_calc_magnitudes(nfft, frequency);
+        if (!s) welch_power.fill(0, magnitudes.size());
+
+        const double *mag = magnitudes.constData();
+        double *power = welch_power.data();
+        for(i = 0; i<(unsigned int) welch_power.size(); i++) {
+            power[i] += mag[i]*mag[i];
+        }
     }
 
-    function_fft_calc_top(cout, points, timelen);
+    double *mag = magnitudes.data();
+    for(i = 0; i<(unsigned int) magnitudes.size(); i++) {
+        mag[i] = sqrt(welch_power.at(i)/segments);
+    }
 
-    free(kiss_fft_state);
-    delete [] cin;
-    delete [] cout;
+    function_fft_fill_harmonics(nfft, frequency);
 }
 
 unsigned int SndAnalyzer::getTop_harmonic() const
@@ -137,10 +358,29 @@ QVector<HarmonicInfo> *SndAnalyzer::getTopHarmonics()
     return top_harmonics;
 }
 
+/*
+    Top harmonics of the spectrum in getHarmonics() after its amplitudes were
+    changed, e.g. averaged over several spectra.
+*/
+void SndAnalyzer::recalcTopHarmonics()
+{
+    unsigned int i, i_start = skip_zero_frequency ? 1 : 0;
+
+    if (harmonics->isEmpty() || magnitudes.size()!=harmonics->size()+(int) i_start) return;
+
+    double *mag = magnitudes.data();
+    const HarmonicInfo *h = harmonics->constData();
+    for(i = 0; i<(unsigned int) harmonics->size(); i++) {
+        mag[i_start+i] = h[i].amp;
+    }
+    function_fft_calc_top(harmonics_nfft, harmonics_base_freq);
+}
+
 void SndAnalyzer::clearTopHarmonics()
 {
     top_harmonics->clear();
 }
+
 double SndAnalyzer::getAmp_filter() const
 {
     return amp_filter;
@@ -151,53 +391,132 @@ void SndAnalyzer::setAmp_filter(double value)
     amp_filter = value;
 }
 
+SndAnalyzerFftSize SndAnalyzer::getFft_size() const
+{
+    return fft_size;
+}
+
+void SndAnalyzer::setFft_size(SndAnalyzerFftSize value)
+{
+    fft_size = value;
+}
 
-void SndAnalyzer::function_fft_calc_top(kiss_fft_cpx *cout, unsigned int points, double timelen)
+SndAnalyzerWindow SndAnalyzer::getWindow() const
 {
-    unsigned int mi;
-    bool mi_set;
-    double max_amp, max_freq, tmp_amp, tmp_amp2, tmp_freq;
-    HarmonicInfo tmp_info;
+    return window;
+}
+
+void SndAnalyzer::setWindow(SndAnalyzerWindow value)
+{
+    window = value;
+}
 
-    unsigned int i, j, i_start, i_finish;
-    double base_freq = points / timelen;
+SndAnalyzerInterpolation SndAnalyzer::getInterpolation() const
+{
+    return interpolation;
+}
 
-    i_start = 0;
-    i_finish = points-1;
+void SndAnalyzer::setInterpolation(SndAnalyzerInterpolation value)
+{
+    interpolation = value;
+}
 
-    if (skip_zero_frequency) {
-        i_start++;
-        i_finish--;
+bool SndAnalyzer::getGroup_peaks() const
+{
+    return group_peaks;
+}
+
+void SndAnalyzer::setGroup_peaks(bool value)
+{
+    group_peaks = value;
+}
+
+/* heap order by magnitude: the weakest of the selected bins stays on top */
+struct SndAnalyzerBinGreater {
+    const double *mag;
+    SndAnalyzerBinGreater(const double *mag) : mag(mag) {}
+    bool operator()(unsigned int a, unsigned int b) const {
+        return mag[a]>mag[b] || (mag[a]==mag[b] && a<b);
+    }
+};
+
+/*
+    Fits a parabola through the peak bin and its neighbours, on magnitudes (quadratic)
+    or on log magnitudes (Gaussian, exact for a Gaussian shaped main lobe).
+    Returns the peak offset in bins, -0.5..0.5, and the interpolated amplitude.
+*/
+double SndAnalyzer::interpolatePeak(unsigned int i, unsigned int i_start, unsigned int i_finish, double *amp)
+{
+    const double *mag = magnitudes.constData();
+    double l, c, r, d, p;
+
+    *amp = mag[i];
+    if (interpolation==SndInterpolationNone || i<=i_start || i>=i_finish) return 0;
+
+    l = mag[i-1];
+    c = mag[i];
+    r = mag[i+1];
+    if (interpolation==SndInterpolationGaussian) {
+        if (l<=0 || c<=0 || r<=0) return 0;
+        l = log(l);
+        c = log(c);
+        r = log(r);
     }
 
-    top_harmonics->clear();
+    d = l - 2*c + r;
+    if (d>=0) return 0;
+    p = 0.5*(l - r)/d;
+    if (p<-0.5 || p>0.5) return 0;
 
-    do {
-        mi_set = false;
-        max_amp = 0;
-        max_freq = 0;
-        for(i = i_start, j = i_finish; i<=j; i++, j--) {
-            tmp_amp = sqrt(sqr(cout[i].r)+sqr(cout[i].i)) / base_freq;
-            tmp_amp2 = sqrt(sqr(cout[j].r)+sqr(cout[j].i)) / base_freq;
-            if (tmp_amp<tmp_amp2) tmp_amp = tmp_amp2;
-            if (max_amp<=tmp_amp) {
-                tmp_freq = i/timelen;
-                mi = i;
-                mi_set = true;
-                max_amp = tmp_amp;
-                max_freq = tmp_freq;
-            }
+    c -= 0.25*(l - r)*p;
+    *amp = interpolation==SndInterpolationGaussian ? exp(c) : c;
+
+    return p;
+}
+
+void SndAnalyzer::function_fft_calc_top(unsigned int nfft, double base_freq)
+{
+    unsigned int i, i_start, i_finish;
+    HarmonicInfo tmp_info;
+
+    i_start = skip_zero_frequency ? 1 : 0;
+    i_finish = nfft/2;
+
+    const double *mag = magnitudes.constData();
+    SndAnalyzerBinGreater greater(mag);
+
+    top_harmonics->clear();
+    top_bins.clear();
+    if (!top_harmonic) return;
+
+    /*
+        Bounded min-heap of top_harmonic bins, O(N log K).
+        With group_peaks only local maxima are candidates, so the leakage
+        bins around one tone are not reported as separate harmonics.
+    */
+    for(i = i_start; i<=i_finish; i++) {
+        if (mag[i]<amp_filter) continue;
+        if (group_peaks) {
+            if (i>i_start && mag[i-1]>mag[i]) continue;
+            if (i<i_finish && mag[i+1]>=mag[i]) continue;
         }
-        if (mi_set && max_amp<amp_filter) mi_set = false;
-        if (mi_set) {
-            tmp_info.amp = max_amp;
-            tmp_info.freq = max_freq;
-            top_harmonics->append(tmp_info);
-            cout[mi].r = cout[points-1-mi].r = 0;
-            cout[mi].i = cout[points-1-mi].i = 0;
+        if (top_bins.size()<(int) top_harmonic) {
+            top_bins.append(i);
+            std::push_heap(top_bins.begin(), top_bins.end(), greater);
+        } else if (greater(i, top_bins.first())) {
+            std::pop_heap(top_bins.begin(), top_bins.end(), greater);
+            top_bins.last() = i;
+            std::push_heap(top_bins.begin(), top_bins.end(), greater);
         }
+    }
 
-    } while (top_harmonics->count()<top_harmonic && mi_set);
+    std::sort_heap(top_bins.begin(), top_bins.end(), greater);
+
+    for(i = 0; i<(unsigned int) top_bins.size(); i++) {
+        double offset = interpolatePeak(top_bins.at(i), i_start, i_finish, &tmp_info.amp);
+        tmp_info.freq = (top_bins.at(i)+offset)*base_freq/nfft;
+        top_harmonics->append(tmp_info);
+    }
 
     if (top_harmonics->count()>0) {
         result_freq = top_harmonics->at(0).freq;
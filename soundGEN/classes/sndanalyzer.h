@@ -2,11 +2,23 @@
 #define SNDANALYZER_H
 
 #include <math.h>
+#include <algorithm>
 #include <QVector>
+#include <QList>
+#include <QMap>
 #include <qDebug>
 #include "../abstractsndcontroller.h"
 #include "../kiss_fft/kiss_fftr.h"
 #include "../kiss_fft/_kiss_fft_guts.h"
+#include "sndbluestein.h"
+
+/*
+    SndFftPadded: samples are zero padded to the next 2^a*3^b*5^c size, bin spacing is frequency/padded size.
+    SndFftExact: bin spacing is frequency/points, slow sizes are transformed through Bluestein.
+*/
+enum SndAnalyzerFftSize { SndFftPadded, SndFftExact };
+enum SndAnalyzerWindow { SndWindowRect, SndWindowHann, SndWindowBlackmanHarris, SndWindowFlatTop };
+enum SndAnalyzerInterpolation { SndInterpolationNone, SndInterpolationQuadratic, SndInterpolationGaussian };
 
 struct HarmonicInfo {
     double freq;
@@ -18,8 +30,12 @@ class SndAnalyzer
 public:
     SndAnalyzer();
     ~SndAnalyzer();
-    void function_fft_top_only(GenSoundFunction fct, PlaySoundFunction pfct, double t1, double t2, double freq, unsigned int points);
-    void function_fft_base(GenSoundFunction fct, PlaySoundFunction pfct, double t1, double t2, double freq, unsigned int points);
+    void function_fft_top_only(GenSoundFunction fct, double t1, double t2, double freq, unsigned int points);
+    void function_fft_base(GenSoundFunction fct, double t1, double t2, double freq, unsigned int points);
+    void samples_fft_top_only(const float *samples, unsigned int points, double frequency);
+    void samples_fft_base(const float *samples, unsigned int points, double frequency);
+    void function_psd_welch(GenSoundFunction fct, double t1, double t2, double freq, unsigned int points, unsigned int segment_points);
+    void samples_psd_welch(const float *samples, unsigned int points, unsigned int segment_points, double frequency);
     double getInstFrequency();
     double getInstAmp();
     unsigned int getTop_harmonic() const;
@@ -30,16 +46,58 @@ public:
     void clearHarmonics();
     QVector<HarmonicInfo> *getTopHarmonics();
     void clearTopHarmonics();
+    void recalcTopHarmonics();
     double getAmp_filter() const;
     void setAmp_filter(double value);
+    bool getGroup_peaks() const;
+    void setGroup_peaks(bool value);
+    SndAnalyzerFftSize getFft_size() const;
+    void setFft_size(SndAnalyzerFftSize value);
+    SndAnalyzerWindow getWindow() const;
+    void setWindow(SndAnalyzerWindow value);
+    SndAnalyzerInterpolation getInterpolation() const;
+    void setInterpolation(SndAnalyzerInterpolation value);
+    void clearPlans();
 private:
+    static const int max_plans = 8;
+    static const unsigned int max_direct_radix = 13;
     double result_freq, result_amp;
     double amp_filter;
     bool skip_zero_frequency;
+    bool group_peaks;
+    SndAnalyzerFftSize fft_size;
+    SndAnalyzerWindow window;
+    SndAnalyzerInterpolation interpolation;
     unsigned int top_harmonic;
+    unsigned int harmonics_nfft;
+    double harmonics_base_freq;
     QVector<HarmonicInfo>* harmonics;
     QVector<HarmonicInfo>* top_harmonics;
-    void function_fft_calc_top(kiss_fft_cpx* cout, unsigned int points, double timelen);
+    QMap<unsigned int, kiss_fftr_cfg> fft_plans;
+    QList<unsigned int> fft_plans_usage;
+    kiss_fft_scalar *fft_in;
+    kiss_fft_cpx *fft_out;
+    unsigned int fft_buffer_size;
+    SndBluestein *bluestein;
+    QVector<kiss_fft_scalar> window_coeffs;
+    SndAnalyzerWindow window_coeffs_type;
+    double window_gain;
+    QVector<double> magnitudes;
+    QVector<unsigned int> top_bins;
+    QVector<double> welch_power;
+    QVector<float> welch_samples;
+    kiss_fftr_cfg getPlan(unsigned int points);
+    unsigned int getTransformSize(unsigned int points);
+    void reserveBuffers(unsigned int points);
+    void applyWindow(unsigned int points);
+    double interpolatePeak(unsigned int i, unsigned int i_start, unsigned int i_finish, double *amp);
+    unsigned int function_fft_fill(GenSoundFunction fct, double t1, double t2, double freq, unsigned int points);
+    unsigned int samples_fft_fill(const float *samples, unsigned int points);
+    unsigned int function_fft_exec(unsigned int points);
+    void function_fft_calc_magnitudes(unsigned int nfft, double base_freq);
+    void function_fft_calc_harmonics(unsigned int nfft, double base_freq);
+    void function_fft_fill_harmonics(unsigned int nfft, double base_freq);
+    void function_fft_calc_top(unsigned int nfft, double base_freq);
 };
 
 #endif // SNDANALYZER_H
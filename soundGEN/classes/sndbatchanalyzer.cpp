@@ -0,0 +1,317 @@
+#include "sndbatchanalyzer.h"
+
+class SndBatchTask : public QRunnable
+{
+public:
+    SndBatchTask(SndBatchFileResult *result, unsigned int harmonics_count) :
+        result(result), harmonics_count(harmonics_count) {}
+    void run() {
+        SndBatchAnalyzer::analyzeFile(result, harmonics_count);
+    }
+private:
+    SndBatchFileResult *result;
+    unsigned int harmonics_count;
+};
+
+SndBatchAnalyzer::SndBatchAnalyzer()
+{
+    harmonics_count = 10;
+}
+
+void SndBatchAnalyzer::addFile(QString filename)
+{
+    SndBatchFileResult result;
+    result.filename = filename;
+    result.frequency = 0;
+    result.channels_count = 0;
+    result.frames_count = 0;
+    results.append(result);
+}
+
+/*
+    Adds the sound files referenced in the [sounds] section of a saved preset,
+    relative names are resolved against the preset directory.
+*/
+bool SndBatchAnalyzer::addPreset(QString preset_filename)
+{
+    if (!QFile::exists(preset_filename)) return false;
+
+    QSettings settings(preset_filename, QSettings::IniFormat);
+    QDir preset_dir = QFileInfo(preset_filename).absoluteDir();
+    int length = settings.value("sounds/sounds_count", 0).toInt();
+
+    for(int i=0; i<length; i++) {
+        QString filename = settings.value("sounds/sound"+QString::number(i), "").toString();
+        if (!filename.isEmpty()) {
+            addFile(QDir::isAbsolutePath(filename) ? filename : preset_dir.absoluteFilePath(filename));
+        }
+    }
+    return true;
+}
+
+int SndBatchAnalyzer::getFilesCount() const
+{
+    return results.size();
+}
+
+unsigned int SndBatchAnalyzer::getHarmonicsCount() const
+{
+    return harmonics_count;
+}
+
+void SndBatchAnalyzer::setHarmonicsCount(unsigned int value)
+{
+    harmonics_count = value;
+}
+
+void SndBatchAnalyzer::run(int threads)
+{
+    QThreadPool pool;
+    if (threads>0) pool.setMaxThreadCount(threads);
+
+    /* the list is not modified while the tasks run, so item addresses stay valid */
+    for(int i=0; i<results.size(); i++) {
+        pool.start(new SndBatchTask(&results[i], harmonics_count));
+    }
+    pool.waitForDone();
+}
+
+const QList<SndBatchFileResult> &SndBatchAnalyzer::getResults() const
+{
+    return results;
+}
+
+void SndBatchAnalyzer::analyzeFile(SndBatchFileResult *result, unsigned int harmonics_count)
+{
+    static const unsigned int chunk_size = 65536;
+    SndWavFile wav;
+    SndMeasurement measurement;
+    QVector<float> chunk(chunk_size);
+    unsigned int c, i, count;
+
+    if (!wav.open(result->filename)) {
+        result->error = wav.getError();
+        return;
+    }
+
+    result->frequency = wav.getFrequency();
+    result->channels_count = wav.getChannelsCount();
+    result->frames_count = wav.getFramesCount();
+    result->channels.resize(result->channels_count);
+    measurement.setHarmonicsCount(harmonics_count);
+
+    for(c = 0; c<result->channels_count; c++) {
+        SndBatchChannelResult &channel = result->channels[c];
+        double peak = 0, sum = 0;
+
+        for(quint64 frame = 0; frame<result->frames_count; frame += count) {
+            count = wav.read(c, frame, chunk.data(), chunk_size);
+            if (!count) break;
+            const float *samples = chunk.constData();
+            for(i = 0; i<count; i++) {
+                if (fabs(samples[i])>peak) peak = fabs(samples[i]);
+                sum += (double) samples[i]*samples[i];
+            }
+        }
+        channel.peak = peak;
+        channel.rms = result->frames_count ? sqrt(sum/result->frames_count) : 0;
+        channel.measurement = measurement.measureFile(&wav, c);
+        channel.harmonics = *measurement.getHarmonicLevels();
+    }
+}
+
+static QString batchNumber(double value, const char *invalid)
+{
+    return qIsFinite(value) ? QString::number(value, 'g', 10) : QString(invalid);
+}
+
+static QString batchDb(double value, const char *invalid)
+{
+    return value>0 ? batchNumber(20*log10(value), invalid) : QString(invalid);
+}
+
+static QString csvString(QString value)
+{
+    if (value.contains(',') || value.contains('"') || value.contains('\n')) {
+        return "\"" + value.replace("\"", "\"\"") + "\"";
+    }
+    return value;
+}
+
+static QString jsonString(QString value)
+{
+    QString out = "\"";
+    for(int i=0; i<value.size(); i++) {
+        QChar ch = value.at(i);
+        if (ch=='"' || ch=='\\') {
+            out += '\\';
+            out += ch;
+        } else if (ch.unicode()<0x20) {
+            out += QString("\\u%1").arg(ch.unicode(), 4, 16, QChar('0'));
+        } else {
+            out += ch;
+        }
+    }
+    return out + "\"";
+}
+
+bool SndBatchAnalyzer::writeCsv(QIODevice *device) const
+{
+    QTextStream out(device);
+    unsigned int h;
+
+    out << "file,channel,frequency,frames,peak,peak_dbfs,rms,rms_dbfs,fundamental_freq,fundamental_amp,"
+           "thd,thd_n,snr,sinad,enob,sfdr";
+    for(h = 1; h<=harmonics_count; h++) {
+        out << ",h" << h << "_freq,h" << h << "_amp";
+    }
+    out << ",error\n";
+
+    for(int f=0; f<results.size(); f++) {
+        const SndBatchFileResult &file = results.at(f);
+        if (!file.error.isEmpty()) {
+            out << csvString(file.filename) << ",,,,,,,,,,,,,,,";
+            for(h = 1; h<=harmonics_count; h++) out << ",,";
+            out << "," << csvString(file.error) << "\n";
+            continue;
+        }
+        for(int c=0; c<file.channels.size(); c++) {
+            const SndBatchChannelResult &channel = file.channels.at(c);
+            const SndMeasurementResult &m = channel.measurement;
+            out << csvString(file.filename) << "," << c << "," << batchNumber(file.frequency, "")
+                << "," << file.frames_count
+                << "," << batchNumber(channel.peak, "") << "," << batchDb(channel.peak, "")
+                << "," << batchNumber(channel.rms, "") << "," << batchDb(channel.rms, "");
+            if (m.valid) {
+                out << "," << batchNumber(m.fundamental_freq, "") << "," << batchNumber(m.fundamental_amp, "")
+                    << "," << batchNumber(m.thd, "") << "," << batchNumber(m.thd_n, "")
+                    << "," << batchNumber(m.snr, "") << "," << batchNumber(m.sinad, "")
+                    << "," << batchNumber(m.enob, "") << "," << batchNumber(m.sfdr, "");
+            } else {
+                out << ",,,,,,,,";
+            }
+            for(h = 0; h<harmonics_count; h++) {
+                if (h<(unsigned int) channel.harmonics.size()) {
+                    out << "," << batchNumber(channel.harmonics.at(h).freq, "") << "," << batchNumber(channel.harmonics.at(h).amp, "");
+                } else {
+                    out << ",,";
+                }
+            }
+            out << ",\n";
+        }
+    }
+    out.flush();
+    return out.status()==QTextStream::Ok;
+}
+
+bool SndBatchAnalyzer::writeJson(QIODevice *device) const
+{
+    QTextStream out(device);
+
+    out << "[\n";
+    for(int f=0; f<results.size(); f++) {
+        const SndBatchFileResult &file = results.at(f);
+        out << "  {\"file\": " << jsonString(file.filename);
+        if (!file.error.isEmpty()) {
+            out << ", \"error\": " << jsonString(file.error) << "}";
+        } else {
+            out << ", \"frequency\": " << batchNumber(file.frequency, "null")
+                << ", \"frames\": " << file.frames_count << ", \"channels\": [";
+            for(int c=0; c<file.channels.size(); c++) {
+                const SndBatchChannelResult &channel = file.channels.at(c);
+                const SndMeasurementResult &m = channel.measurement;
+                out << (c ? ",\n" : "\n") << "    {\"channel\": " << c
+                    << ", \"peak\": " << batchNumber(channel.peak, "null") << ", \"peak_dbfs\": " << batchDb(channel.peak, "null")
+                    << ", \"rms\": " << batchNumber(channel.rms, "null") << ", \"rms_dbfs\": " << batchDb(channel.rms, "null");
+                if (m.valid) {
+                    out << ", \"fundamental_freq\": " << batchNumber(m.fundamental_freq, "null")
+                        << ", \"fundamental_amp\": " << batchNumber(m.fundamental_amp, "null")
+                        << ", \"thd\": " << batchNumber(m.thd, "null") << ", \"thd_n\": " << batchNumber(m.thd_n, "null")
+                        << ", \"snr\": " << batchNumber(m.snr, "null") << ", \"sinad\": " << batchNumber(m.sinad, "null")
+                        << ", \"enob\": " << batchNumber(m.enob, "null") << ", \"sfdr\": " << batchNumber(m.sfdr, "null");
+                }
+                out << ", \"harmonics\": [";
+                for(int h=0; h<channel.harmonics.size(); h++) {
+                    out << (h ? ", " : "") << "{\"freq\": " << batchNumber(channel.harmonics.at(h).freq, "null")
+                        << ", \"amp\": " << batchNumber(channel.harmonics.at(h).amp, "null") << "}";
+                }
+                out << "]}";
+            }
+            out << "\n  ]}";
+        }
+        out << (f+1<results.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+    out.flush();
+    return out.status()==QTextStream::Ok;
+}
+
+/*
+    soundGEN --analyze [--preset file] [--csv file] [--json file] [--threads n] [--harmonics n] files...
+    Without --csv and --json the CSV table is written to the standard output.
+*/
+int SndBatchAnalyzer::runCommandLine(QStringList args)
+{
+    SndBatchAnalyzer batch;
+    QString csv_filename, json_filename;
+    QTextStream err(stderr);
+    int threads = 0;
+
+    for(int i=0; i<args.size(); i++) {
+        QString arg = args.at(i);
+        bool has_value = i+1<args.size();
+        if (arg=="--analyze") {
+            continue;
+        } else if (arg=="--preset" && has_value) {
+            QString preset = args.at(++i);
+            if (!batch.addPreset(preset)) {
+                err << "Can't read preset: " << preset << "\n";
+                return 1;
+            }
+        } else if (arg=="--csv" && has_value) {
+            csv_filename = args.at(++i);
+        } else if (arg=="--json" && has_value) {
+            json_filename = args.at(++i);
+        } else if (arg=="--threads" && has_value) {
+            threads = args.at(++i).toInt();
+        } else if (arg=="--harmonics" && has_value) {
+            batch.setHarmonicsCount(qMax(args.at(++i).toInt(), 2));
+        } else if (arg.startsWith("--")) {
+            err << "Unknown option: " << arg << "\n";
+            return 1;
+        } else {
+            batch.addFile(arg);
+        }
+    }
+
+    if (!batch.getFilesCount()) {
+        err << "Usage: soundGEN --analyze [--preset file] [--csv file] [--json file] [--threads n] [--harmonics n] files...\n";
+        return 1;
+    }
+
+    batch.run(threads);
+
+    bool ok = true;
+    if (csv_filename.isEmpty() && json_filename.isEmpty()) {
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        ok = batch.writeCsv(&out);
+    }
+    if (!csv_filename.isEmpty()) {
+        QFile out(csv_filename);
+        ok = out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text) && batch.writeCsv(&out) && ok;
+    }
+    if (!json_filename.isEmpty()) {
+        QFile out(json_filename);
+        ok = out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text) && batch.writeJson(&out) && ok;
+    }
+    if (!ok) {
+        err << "Can't write results\n";
+        return 1;
+    }
+
+    for(int f=0; f<batch.getResults().size(); f++) {
+        if (!batch.getResults().at(f).error.isEmpty()) return 2;
+    }
+    return 0;
+}
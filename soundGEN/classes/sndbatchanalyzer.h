@@ -0,0 +1,62 @@
+#ifndef SNDBATCHANALYZER_H
+#define SNDBATCHANALYZER_H
+
+#include <math.h>
+#include <QVector>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSettings>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QRunnable>
+#include <qnumeric.h>
+#include "sndmeasurement.h"
+#include "sndwavfile.h"
+
+struct SndBatchChannelResult {
+    double peak;
+    double rms;
+    SndMeasurementResult measurement;
+    QVector<HarmonicInfo> harmonics;
+};
+
+struct SndBatchFileResult {
+    QString filename;
+    QString error;
+    double frequency;
+    unsigned int channels_count;
+    quint64 frames_count;
+    QVector<SndBatchChannelResult> channels;
+};
+
+/*
+    Headless analysis of many sound files: every file is analysed by its own
+    task on a thread pool, sample data is read straight from the mapped file.
+*/
+class SndBatchAnalyzer
+{
+public:
+    SndBatchAnalyzer();
+    void addFile(QString filename);
+    bool addPreset(QString preset_filename);
+    int getFilesCount() const;
+    unsigned int getHarmonicsCount() const;
+    void setHarmonicsCount(unsigned int value);
+
+    void run(int threads = 0);
+    const QList<SndBatchFileResult> &getResults() const;
+    bool writeCsv(QIODevice *device) const;
+    bool writeJson(QIODevice *device) const;
+
+    static void analyzeFile(SndBatchFileResult *result, unsigned int harmonics_count);
+    static int runCommandLine(QStringList args);
+private:
+    unsigned int harmonics_count;
+    QList<SndBatchFileResult> results;
+};
+
+#endif // SNDBATCHANALYZER_H
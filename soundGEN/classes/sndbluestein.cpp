@@ -0,0 +1,78 @@
+#include "sndbluestein.h"
+
+SndBluestein::SndBluestein(unsigned int points)
+{
+    unsigned int i;
+
+    this->points = points;
+    conv_size = kiss_fft_next_fast_size(2*points-1);
+    conv_forward = kiss_fft_alloc(conv_size, 0, 0, 0);
+    conv_inverse = kiss_fft_alloc(conv_size, 1, 0, 0);
+
+    chirp = (kiss_fft_cpx*) qMallocAligned(points*sizeof(kiss_fft_cpx), 32);
+    chirp_spectrum = (kiss_fft_cpx*) qMallocAligned(conv_size*sizeof(kiss_fft_cpx), 32);
+    work = (kiss_fft_cpx*) qMallocAligned(conv_size*sizeof(kiss_fft_cpx), 32);
+    work_spectrum = (kiss_fft_cpx*) qMallocAligned(conv_size*sizeof(kiss_fft_cpx), 32);
+
+    /* chirp[n] = exp(-i*pi*n^2/points), n^2 is reduced modulo 2*points to keep the phase exact */
+    for(i = 0; i<points; i++) {
+        double phase = M_PI * (double) (((quint64) i*i) % (2*(quint64) points)) / points;
+        chirp[i].r = cos(phase);
+        chirp[i].i = -sin(phase);
+    }
+
+    /* convolution kernel conj(chirp[|m|]) for m in -(points-1)..points-1, wrapped to conv_size */
+    for(i = 0; i<conv_size; i++) {
+        work[i].r = work[i].i = 0;
+    }
+    for(i = 0; i<points; i++) {
+        work[i].r = chirp[i].r;
+        work[i].i = -chirp[i].i;
+        if (i) work[conv_size-i] = work[i];
+    }
+    kiss_fft(conv_forward, work, chirp_spectrum);
+}
+
+SndBluestein::~SndBluestein()
+{
+    kiss_fft_free(conv_forward);
+    kiss_fft_free(conv_inverse);
+    qFreeAligned(chirp);
+    qFreeAligned(chirp_spectrum);
+    qFreeAligned(work);
+    qFreeAligned(work_spectrum);
+}
+
+unsigned int SndBluestein::getPoints() const
+{
+    return points;
+}
+
+void SndBluestein::exec(const kiss_fft_scalar *in, kiss_fft_cpx *out)
+{
+    unsigned int i;
+    kiss_fft_scalar r, im;
+
+    for(i = 0; i<points; i++) {
+        work[i].r = in[i]*chirp[i].r;
+        work[i].i = in[i]*chirp[i].i;
+    }
+    for(; i<conv_size; i++) {
+        work[i].r = work[i].i = 0;
+    }
+
+    kiss_fft(conv_forward, work, work_spectrum);
+    for(i = 0; i<conv_size; i++) {
+        r  = work_spectrum[i].r*chirp_spectrum[i].r - work_spectrum[i].i*chirp_spectrum[i].i;
+        im = work_spectrum[i].r*chirp_spectrum[i].i + work_spectrum[i].i*chirp_spectrum[i].r;
+        work_spectrum[i].r = r / conv_size;
+        work_spectrum[i].i = im / conv_size;
+    }
+    kiss_fft(conv_inverse, work_spectrum, work);
+
+    /* only the non-negative half of the spectrum is used for real input */
+    for(i = 0; i<=points/2; i++) {
+        out[i].r = work[i].r*chirp[i].r - work[i].i*chirp[i].i;
+        out[i].i = work[i].r*chirp[i].i + work[i].i*chirp[i].r;
+    }
+}
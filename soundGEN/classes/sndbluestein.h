@@ -0,0 +1,31 @@
+#ifndef SNDBLUESTEIN_H
+#define SNDBLUESTEIN_H
+
+#include <math.h>
+#include <QtGlobal>
+#include "../kiss_fft/kiss_fft.h"
+
+/*
+    Real input DFT of any length through the chirp-z (Bluestein) algorithm.
+    The transform is computed as a convolution of fast (2^a*3^b*5^c) size,
+    so lengths with large prime factors keep the exact bin spacing of
+    frequency/points without falling back to slow generic butterflies.
+*/
+class SndBluestein
+{
+public:
+    SndBluestein(unsigned int points);
+    ~SndBluestein();
+    unsigned int getPoints() const;
+    void exec(const kiss_fft_scalar *in, kiss_fft_cpx *out);
+private:
+    Q_DISABLE_COPY(SndBluestein)
+
+    unsigned int points, conv_size;
+    kiss_fft_cfg conv_forward, conv_inverse;
+    kiss_fft_cpx *chirp;
+    kiss_fft_cpx *chirp_spectrum;
+    kiss_fft_cpx *work, *work_spectrum;
+};
+
+#endif // SNDBLUESTEIN_H
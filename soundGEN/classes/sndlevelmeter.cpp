@@ -0,0 +1,192 @@
+#include "sndlevelmeter.h"
+
+/*
+    Four independent accumulators let the compiler vectorize the loop,
+    the lanes are combined at the end.
+*/
+static void level_reduce(const float *s, unsigned int count, float *peak, float *sum, unsigned int *clipped)
+{
+    float p[4] = {0, 0, 0, 0};
+    float q[4] = {0, 0, 0, 0};
+    unsigned int c[4] = {0, 0, 0, 0};
+    unsigned int i, j;
+    float a;
+
+    for(i = 0; i+4<=count; i+=4) {
+        for(j = 0; j<4; j++) {
+            a = fabsf(s[i+j]);
+            p[j] = a>p[j] ? a : p[j];
+            q[j] += s[i+j]*s[i+j];
+            c[j] += a>1.0f;
+        }
+    }
+    for(; i<count; i++) {
+        a = fabsf(s[i]);
+        p[0] = a>p[0] ? a : p[0];
+        q[0] += s[i]*s[i];
+        c[0] += a>1.0f;
+    }
+
+    *peak = qMax(qMax(p[0], p[1]), qMax(p[2], p[3]));
+    *sum = (q[0]+q[1]) + (q[2]+q[3]);
+    *clipped = c[0]+c[1]+c[2]+c[3];
+}
+
+SndLevelMeter::SndLevelMeter()
+{
+    blocks = partial = 0;
+    clips = 0;
+    channels_count = 0;
+    block_frames = 1;
+    capacity = 0;
+    partial_frames = 0;
+    write_position.storeRelease(0);
+    max_blocks.storeRelease(0);
+}
+
+SndLevelMeter::~SndLevelMeter()
+{
+    if (blocks) delete[] blocks;
+    if (partial) delete[] partial;
+    if (clips) delete[] clips;
+}
+
+void SndLevelMeter::setFormat(unsigned int channels_count, unsigned int block_frames, unsigned int capacity)
+{
+    if (this->channels_count!=channels_count || this->capacity!=capacity) {
+        if (blocks) delete[] blocks;
+        if (partial) delete[] partial;
+        if (clips) delete[] clips;
+        blocks = partial = 0;
+        clips = 0;
+        this->channels_count = channels_count;
+        this->capacity = capacity;
+        if (channels_count*capacity>0) {
+            blocks = new SndLevelBlock[channels_count*capacity];
+            partial = new SndLevelBlock[channels_count];
+            clips = new QAtomicInt[channels_count];
+        }
+    }
+    this->block_frames = qMax(block_frames, 1u);
+    for(unsigned int i = 0; clips && i<channels_count; i++) {
+        clips[i].storeRelease(0);
+    }
+    reset();
+}
+
+/* clip counts are kept, a seek moves the position but doesn't start a new measurement */
+void SndLevelMeter::reset(quint32 position)
+{
+    if (blocks) memset(blocks, 0, channels_count*capacity*sizeof(SndLevelBlock));
+    if (partial) memset(partial, 0, channels_count*sizeof(SndLevelBlock));
+    partial_frames = position % block_frames;
+    max_blocks.storeRelease(0);
+    write_position.storeRelease((int) position);
+}
+
+unsigned int SndLevelMeter::getChannelsCount() const
+{
+    return channels_count;
+}
+
+unsigned int SndLevelMeter::getBlockFrames() const
+{
+    return block_frames;
+}
+
+quint32 SndLevelMeter::getWritePosition() const
+{
+    return (quint32) write_position.loadAcquire();
+}
+
+void SndLevelMeter::process(unsigned int channel, const float *samples, unsigned int count)
+{
+    if (!blocks || channel>=channels_count) return;
+
+    quint32 block = getWritePosition()/block_frames;
+    unsigned int filled = partial_frames;
+    unsigned int part, clipped, total_clipped = 0;
+    SndLevelBlock *acc = partial + channel;
+    float peak, sum;
+
+    if (count/block_frames+2>(unsigned int) max_blocks.loadAcquire()) {
+        max_blocks.storeRelease((int) (count/block_frames+2));
+    }
+
+    while (count>0) {
+        part = qMin(count, block_frames-filled);
+        level_reduce(samples, part, &peak, &sum, &clipped);
+        if (peak>acc->peak) acc->peak = peak;
+        acc->sum += sum;
+        total_clipped += clipped;
+        samples += part;
+        count -= part;
+        filled += part;
+
+        if (filled==block_frames) {
+            blocks[channel*capacity + block%capacity] = *acc;
+            acc->peak = acc->sum = 0;
+            filled = 0;
+            block++;
+        }
+    }
+
+    if (total_clipped>0) clips[channel].fetchAndAddRelaxed((int) total_clipped);
+}
+
+void SndLevelMeter::commit(unsigned int count)
+{
+    partial_frames = (partial_frames+count) % block_frames;
+    write_position.storeRelease((int) (getWritePosition()+count));
+}
+
+bool SndLevelMeter::isAvailable(quint32 block, quint32 count, quint32 end_block) const
+{
+    quint32 distance = end_block-block;
+    return distance>=count && distance<=capacity-qMin(capacity, (quint32) max_blocks.loadAcquire());
+}
+
+/*
+    Levels of the complete blocks covering frames [from, to). Returns false
+    if none of them is written yet or they are already overwritten.
+*/
+bool SndLevelMeter::getLevels(unsigned int channel, quint32 from, quint32 to, double *peak, double *rms) const
+{
+    if (!blocks || channel>=channels_count) return false;
+
+    quint32 end_block = getWritePosition()/block_frames;
+    quint32 first = from/block_frames;
+    quint32 last = qMax(to/block_frames, first+1);
+    /* only blocks that are complete */
+    if ((qint32) (last-end_block)>0) last = end_block;
+    if ((qint32) (last-first)<=0) return false;
+    if (!isAvailable(first, last-first, end_block)) return false;
+
+    const SndLevelBlock *row = blocks + channel*capacity;
+    double p = 0, sum = 0;
+    quint32 b;
+    for(b = first; b!=last; b++) {
+        const SndLevelBlock &level = row[b%capacity];
+        if (level.peak>p) p = level.peak;
+        sum += level.sum;
+    }
+
+    /* full barrier: the blocks above must be read before the position is checked again */
+    if (!isAvailable(first, last-first, ((quint32) write_position.fetchAndAddOrdered(0))/block_frames)) return false;
+
+    *peak = p;
+    *rms = sqrt(sum/((last-first)*block_frames));
+    return true;
+}
+
+unsigned int SndLevelMeter::getClipCount(unsigned int channel) const
+{
+    if (!clips || channel>=channels_count) return 0;
+    return (unsigned int) clips[channel].loadAcquire();
+}
+
+void SndLevelMeter::resetClipCount(unsigned int channel)
+{
+    if (!clips || channel>=channels_count) return;
+    clips[channel].storeRelease(0);
+}
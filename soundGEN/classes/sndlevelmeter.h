@@ -0,0 +1,54 @@
+#ifndef SNDLEVELMETER_H
+#define SNDLEVELMETER_H
+
+#include <string.h>
+#include <math.h>
+#include <QtGlobal>
+#include <QAtomicInt>
+
+struct SndLevelBlock {
+    float peak;
+    float sum;
+};
+
+/*
+    Peak and RMS of rendered samples, measured by the producer (audio thread) in short
+    blocks and kept in a ring of block levels, so a meter can show the levels of any
+    recent position without touching the samples. Samples above full scale are counted
+    as clipped per channel.
+    Publishing works like SndRingBuffer: blocks are complete before the write position
+    passes them, readers check afterwards that the blocks were not overwritten.
+*/
+class SndLevelMeter
+{
+public:
+    SndLevelMeter();
+    ~SndLevelMeter();
+    void setFormat(unsigned int channels_count, unsigned int block_frames, unsigned int capacity);
+    void reset(quint32 position = 0);
+    unsigned int getChannelsCount() const;
+    unsigned int getBlockFrames() const;
+    quint32 getWritePosition() const;
+
+    void process(unsigned int channel, const float *samples, unsigned int count);
+    void commit(unsigned int count);
+
+    bool getLevels(unsigned int channel, quint32 from, quint32 to, double *peak, double *rms) const;
+    unsigned int getClipCount(unsigned int channel) const;
+    void resetClipCount(unsigned int channel);
+private:
+    Q_DISABLE_COPY(SndLevelMeter)
+
+    SndLevelBlock *blocks;
+    SndLevelBlock *partial;
+    QAtomicInt *clips;
+    unsigned int channels_count;
+    unsigned int block_frames;
+    unsigned int capacity;
+    unsigned int partial_frames;
+    mutable QAtomicInt write_position;
+    QAtomicInt max_blocks;
+    bool isAvailable(quint32 block, quint32 count, quint32 end_block) const;
+};
+
+#endif // SNDLEVELMETER_H
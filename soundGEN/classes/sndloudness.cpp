@@ -0,0 +1,196 @@
+#include "sndloudness.h"
+
+const double SndLoudness::absolute_gate = -70.0;
+const double SndLoudness::relative_gate = -10.0;
+
+SndLoudness::SndLoudness()
+{
+    sub_block_frames = 1;
+    sub_position = sub_count = 0;
+    updateFilters(48000);
+}
+
+void SndLoudness::setFormat(unsigned int channels_count, double frequency)
+{
+    channels.resize(channels_count);
+    sub_block_frames = qMax(1, (int) round(frequency/10.0));
+    updateFilters(frequency);
+    reset();
+}
+
+void SndLoudness::reset()
+{
+    for(int i=0; i<channels.size(); i++) {
+        SndLoudnessChannel &c = channels[i];
+        c.z1[0] = c.z1[1] = c.z2[0] = c.z2[1] = 0;
+        c.energy = 0;
+        c.true_peak = 0;
+        for(unsigned int j=0; j<phase_taps; j++) c.history[j] = 0;
+    }
+    sub_blocks.clear();
+    sub_position = sub_count = 0;
+}
+
+/*
+    K-weighting for any sample rate: the BS.1770 shelf and high-pass
+    prototypes are re-derived with the bilinear transform.
+*/
+void SndLoudness::updateFilters(double frequency)
+{
+    double k, vh, vb, q, a0;
+
+    k = tan(M_PI*1681.974450955533/frequency);
+    vh = pow(10.0, 3.999843853973347/20.0);
+    vb = pow(vh, 0.4996667741545416);
+    q = 0.7071752369554196;
+    a0 = 1.0 + k/q + k*k;
+    b1[0] = (vh + vb*k/q + k*k)/a0;
+    b1[1] = 2.0*(k*k - vh)/a0;
+    b1[2] = (vh - vb*k/q + k*k)/a0;
+    a1[0] = 1.0;
+    a1[1] = 2.0*(k*k - 1.0)/a0;
+    a1[2] = (1.0 - k/q + k*k)/a0;
+
+    k = tan(M_PI*38.13547087602444/frequency);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k/q + k*k;
+    b2[0] = 1.0;
+    b2[1] = -2.0;
+    b2[2] = 1.0;
+    a2[0] = 1.0;
+    a2[1] = 2.0*(k*k - 1.0)/a0;
+    a2[2] = (1.0 - k/q + k*k)/a0;
+
+    /*
+        Blackman windowed sinc interpolator cut off at the source Nyquist frequency.
+        Phase p sits p/oversampling of a sample after history[center], so phase 0 is
+        the sample itself; every phase is normalized to unity DC gain.
+    */
+    unsigned int center = phase_taps/2 - 1;
+    double x, w, sum;
+    for(unsigned int p=0; p<oversampling; p++) {
+        sum = 0;
+        for(unsigned int j=0; j<phase_taps; j++) {
+            x = (double) j - center - (double) p/oversampling;
+            w = 0.42 + 0.5*cos(2.0*M_PI*x/phase_taps) + 0.08*cos(4.0*M_PI*x/phase_taps);
+            phases[p][j] = (x==0 ? 1.0 : sin(M_PI*x)/(M_PI*x))*w;
+            sum += phases[p][j];
+        }
+        for(unsigned int j=0; j<phase_taps; j++) phases[p][j] /= sum;
+    }
+}
+
+void SndLoudness::process(unsigned int channel, const float *samples, unsigned int count)
+{
+    SndLoudnessChannel &c = channels[channel];
+    unsigned int i, j, p, position = sub_position, block = sub_count;
+    double x, y, energy = c.energy, peak = c.true_peak;
+    float s;
+
+    for(i=0; i<count; i++) {
+        s = samples[i];
+
+        /* transposed direct form II, one stage after another */
+        x = s;
+        y = b1[0]*x + c.z1[0];
+        c.z1[0] = b1[1]*x - a1[1]*y + c.z2[0];
+        c.z2[0] = b1[2]*x - a1[2]*y;
+        x = y;
+        y = b2[0]*x + c.z1[1];
+        c.z1[1] = b2[1]*x - a2[1]*y + c.z2[1];
+        c.z2[1] = b2[2]*x - a2[2]*y;
+        energy += y*y;
+
+        for(j=phase_taps-1; j>0; j--) c.history[j] = c.history[j-1];
+        c.history[0] = s;
+        for(p=0; p<oversampling; p++) {
+            y = 0;
+            for(j=0; j<phase_taps; j++) y += phases[p][j]*c.history[j];
+            y = fabs(y);
+            if (y>peak) peak = y;
+        }
+
+        if (++position==sub_block_frames) {
+            if (sub_blocks.size()<=(int) block) sub_blocks.append(0);
+            sub_blocks[block++] += energy;
+            energy = 0;
+            position = 0;
+        }
+    }
+
+    c.energy = energy;
+    c.true_peak = peak;
+}
+
+void SndLoudness::commit(unsigned int count)
+{
+    sub_count += (sub_position + count)/sub_block_frames;
+    sub_position = (sub_position + count) % sub_block_frames;
+}
+
+bool SndLoudness::isValid() const
+{
+    return sub_blocks.size()>=4;
+}
+
+/*
+    Two gates: blocks below -70 LUFS are dropped, then blocks 10 LU below
+    the loudness of the remaining ones.
+*/
+double SndLoudness::getIntegratedLoudness() const
+{
+    QVector<double> blocks;
+    double sum, gate;
+    int i, count;
+
+    for(i=0; i+4<=sub_blocks.size(); i++) {
+        sum = sub_blocks.at(i) + sub_blocks.at(i+1) + sub_blocks.at(i+2) + sub_blocks.at(i+3);
+        blocks.append(sum/(4.0*sub_block_frames));
+    }
+
+    gate = absolute_gate;
+    for(int pass=0; pass<2; pass++) {
+        sum = 0;
+        count = 0;
+        for(i=0; i<blocks.size(); i++) {
+            if (blockLoudness(blocks.at(i))>gate) {
+                sum += blocks.at(i);
+                count++;
+            }
+        }
+        if (!count) return -HUGE_VAL;
+        gate = qMax(absolute_gate, blockLoudness(sum/count) + relative_gate);
+    }
+
+    return blockLoudness(sum/count);
+}
+
+double SndLoudness::getTruePeak() const
+{
+    double peak = 0;
+    for(int i=0; i<channels.size(); i++) {
+        peak = qMax(peak, channels.at(i).true_peak);
+    }
+    return peak;
+}
+
+double SndLoudness::getTruePeak(unsigned int channel) const
+{
+    if (channel>=(unsigned int) channels.size()) return 0;
+    return channels.at(channel).true_peak;
+}
+
+double SndLoudness::toDb(double value)
+{
+    return value>0 ? 20.0*log10(value) : -HUGE_VAL;
+}
+
+double SndLoudness::fromDb(double db)
+{
+    return pow(10.0, db/20.0);
+}
+
+double SndLoudness::blockLoudness(double energy)
+{
+    return energy>0 ? -0.691 + 10.0*log10(energy) : -HUGE_VAL;
+}
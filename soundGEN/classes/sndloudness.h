@@ -0,0 +1,58 @@
+#ifndef SNDLOUDNESS_H
+#define SNDLOUDNESS_H
+
+#include <math.h>
+#include <QtGlobal>
+#include <QVector>
+
+struct SndLoudnessChannel {
+    double z1[2], z2[2];
+    double energy;
+    double true_peak;
+    float history[12];
+};
+
+/*
+    Integrated loudness (EBU R128 / ITU-R BS.1770) and true-peak of rendered samples.
+    Samples are K-weighted by two biquads, summed in 100 ms sub-blocks and gated over
+    400 ms blocks with 75% overlap. True-peak is the peak of the signal oversampled 4x
+    by a 48 tap polyphase filter, one phase of which is at the sample instants.
+    All channels are weighted 1.0: channel functions have no speaker layout.
+    Usage is like SndLevelMeter: process() every channel, then commit() the frames.
+*/
+class SndLoudness
+{
+public:
+    SndLoudness();
+    void setFormat(unsigned int channels_count, double frequency);
+    void reset();
+
+    void process(unsigned int channel, const float *samples, unsigned int count);
+    void commit(unsigned int count);
+
+    bool isValid() const;
+    double getIntegratedLoudness() const;
+    double getTruePeak() const;
+    double getTruePeak(unsigned int channel) const;
+
+    static double toDb(double value);
+    static double fromDb(double db);
+private:
+    static const unsigned int oversampling = 4;
+    static const unsigned int phase_taps = 12;
+    static const double absolute_gate;
+    static const double relative_gate;
+
+    QVector<SndLoudnessChannel> channels;
+    QVector<double> sub_blocks;
+    double b1[3], a1[3], b2[3], a2[3];
+    float phases[oversampling][phase_taps];
+    unsigned int sub_block_frames;
+    unsigned int sub_position;
+    unsigned int sub_count;
+
+    void updateFilters(double frequency);
+    static double blockLoudness(double energy);
+};
+
+#endif // SNDLOUDNESS_H
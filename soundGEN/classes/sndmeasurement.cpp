@@ -0,0 +1,244 @@
+#include "sndmeasurement.h"
+
+SndMeasurement::SndMeasurement()
+{
+    analyzer = new SndAnalyzer();
+    analyzer->setTop_harmonic(0);
+    analyzer->setSkip_zero_frequency(false);
+    analyzer->setWindow(SndWindowBlackmanHarris);
+    harmonics_count = 10;
+    segment_size = 32768;
+    reset(44100);
+}
+
+SndMeasurement::~SndMeasurement()
+{
+    delete analyzer;
+}
+
+unsigned int SndMeasurement::getHarmonicsCount() const
+{
+    return harmonics_count;
+}
+
+void SndMeasurement::setHarmonicsCount(unsigned int value)
+{
+    harmonics_count = qMax(value, 2u);
+}
+
+unsigned int SndMeasurement::getSegmentSize() const
+{
+    return segment_size;
+}
+
+void SndMeasurement::setSegmentSize(unsigned int value)
+{
+    segment_size = qMax(value, 256u);
+}
+
+void SndMeasurement::reset(double frequency)
+{
+    this->frequency = frequency;
+    power.clear();
+    segments_count = 0;
+    points = 0;
+    bin_freq = 0;
+    peak = 0;
+    harmonic_levels.clear();
+}
+
+/*
+    All segments must have the same length, their power spectra are summed.
+*/
+void SndMeasurement::addSegment(const float *samples, unsigned int count)
+{
+    unsigned int i;
+
+    if (count<256 || (segments_count && count!=points)) return;
+
+    analyzer->samples_fft_base(samples, count, frequency);
+    const QVector<HarmonicInfo> *bins = analyzer->getHarmonics();
+    if (bins->size()<2) return;
+
+    if (!segments_count) {
+        power.fill(0, bins->size());
+        points = count;
+        bin_freq = bins->at(1).freq;
+    }
+    double *p = power.data();
+    const HarmonicInfo *b = bins->constData();
+    for(i = 0; i<(unsigned int) power.size(); i++) {
+        p[i] += b[i].amp*b[i].amp;
+    }
+    if (analyzer->getInstAmp()>peak) peak = analyzer->getInstAmp();
+    segments_count++;
+}
+
+double SndMeasurement::lobePower(int center, int *from, int *to) const
+{
+    double sum = 0;
+    *from = qMax(center-(int) lobe_bins, 0);
+    *to = qMin(center+(int) lobe_bins, power.size()-1);
+    for(int i = *from; i<=*to; i++) {
+        sum += power.at(i);
+    }
+    return sum;
+}
+
+SndMeasurementResult SndMeasurement::calculate()
+{
+    SndMeasurementResult result;
+    int i, k1 = 0, from, to, dc_to, f_from, f_to;
+    double p_total = 0, p_fund, p_harm = 0, p_spur = 0;
+
+    memset(&result, 0, sizeof(result));
+    result.peak = peak;
+    harmonic_levels.clear();
+    if (!segments_count || power.size()<(int) (4*lobe_bins)) return result;
+
+    const double *p = power.constData();
+    int bins = power.size();
+
+    /* fundamental: strongest bin above the DC lobe */
+    for(i = lobe_bins+1; i<bins; i++) {
+        if (p[i]>p[k1]) k1 = i;
+    }
+    if (k1<=(int) lobe_bins || p[k1]<=0) return result;
+
+    /* Gaussian interpolation on log power: fractional bin and peak power */
+    double offset = 0, p_peak = p[k1];
+    if (k1+1<bins && p[k1-1]>0 && p[k1+1]>0) {
+        double l = log(p[k1-1]), c = log(p[k1]), r = log(p[k1+1]);
+        double d = l - 2*c + r;
+        if (d<0) {
+            offset = qBound(-0.5, 0.5*(l - r)/d, 0.5);
+            p_peak = exp(c - 0.25*(l - r)*offset);
+        }
+    }
+    result.fundamental_freq = (k1+offset)*bin_freq;
+    result.fundamental_amp = sqrt(p_peak/segments_count) * 2*frequency/points;
+
+    lobePower(0, &from, &dc_to);
+    for(i = dc_to+1; i<bins; i++) {
+        p_total += p[i];
+    }
+    p_fund = lobePower(k1, &f_from, &f_to);
+
+    /* analyzer amplitudes are A*points/(2*frequency) for a tone of amplitude A */
+    double amp_k = 2*frequency/points;
+    HarmonicInfo level;
+    level.freq = result.fundamental_freq;
+    level.amp = result.fundamental_amp;
+    harmonic_levels.append(level);
+
+    for(unsigned int h = 2; h<=harmonics_count; h++) {
+        int center = (int) floor(h*(k1+offset)+0.5);
+        if (center+(int) lobe_bins>=bins) break;
+        p_harm += lobePower(center, &from, &to);
+
+        level.freq = h*result.fundamental_freq;
+        level.amp = sqrt(qMax(qMax(p[center-1], p[center]), p[center+1])/segments_count) * amp_k;
+        harmonic_levels.append(level);
+    }
+
+    for(i = dc_to+1; i<bins; i++) {
+        if ((i<f_from || i>f_to) && p[i]>p_spur) p_spur = p[i];
+    }
+
+    double p_noise_dist = qMax(p_total - p_fund, 0.0);
+    double p_noise = qMax(p_noise_dist - p_harm, 0.0);
+    /* guard against exact zero for synthetic signals */
+    double tiny = p_fund*1e-30;
+
+    result.thd   = sqrt(p_harm/p_fund);
+    result.thd_n = sqrt(p_noise_dist/p_fund);
+    result.snr   = 10*log10(p_fund/(p_noise+tiny));
+    result.sinad = 10*log10(p_fund/(p_noise_dist+tiny));
+    result.enob  = (result.sinad - 1.76)/6.02;
+    result.sfdr  = 10*log10(p_peak/(p_spur+tiny));
+    result.valid = true;
+
+    return result;
+}
+
+SndMeasurementResult SndMeasurement::measure(const float *samples, unsigned int count, double frequency)
+{
+    reset(frequency);
+    addSegment(samples, count);
+    return calculate();
+}
+
+SndMeasurementResult SndMeasurement::measureTap(const SndRingBuffer *tap, unsigned int channel, unsigned int count, double frequency)
+{
+    reset(frequency);
+    if (segment.size()<(int) count) segment.resize(count);
+    if (tap->readLatest(channel, segment.data(), count)) {
+        addSegment(segment.constData(), count);
+    }
+    return calculate();
+}
+
+/*
+    Long files are measured on up to max_file_segments segments spread evenly over the file,
+    so the time does not grow with the file duration.
+*/
+SndMeasurementResult SndMeasurement::measureFile(const SndWavFile *wav, unsigned int channel)
+{
+    quint64 frames = wav->getFramesCount();
+    unsigned int size = (unsigned int) qMin((quint64) segment_size, frames);
+    unsigned int i, count = qMin((quint64) max_file_segments, frames/qMax(size, 1u));
+
+    reset(wav->getFrequency());
+    if (segment.size()<(int) size) segment.resize(size);
+
+    for(i = 0; i<count; i++) {
+        quint64 frame = count>1 ? (frames-size)*i/(count-1) : 0;
+        if (wav->read(channel, frame, segment.data(), size)==size) {
+            addSegment(segment.constData(), size);
+        }
+    }
+    return calculate();
+}
+
+const QVector<HarmonicInfo> *SndMeasurement::getHarmonicLevels() const
+{
+    return &harmonic_levels;
+}
+
+QString SndMeasurement::toText(const SndMeasurementResult &result)
+{
+    if (!result.valid) return "-";
+
+    return QString("F: %1 Hz, A: %2, peak: %3\nTHD: %4 %, THD+N: %5 %\nSNR: %6 dB, SINAD: %7 dB, ENOB: %8, SFDR: %9 dBc")
+            .arg(result.fundamental_freq, 0, 'f', 2)
+            .arg(result.fundamental_amp, 0, 'f', 4)
+            .arg(result.peak, 0, 'f', 4)
+            .arg(100*result.thd, 0, 'g', 4)
+            .arg(100*result.thd_n, 0, 'g', 4)
+            .arg(result.snr, 0, 'f', 1)
+            .arg(result.sinad, 0, 'f', 1)
+            .arg(result.enob, 0, 'f', 1)
+            .arg(result.sfdr, 0, 'f', 1);
+}
+
+void SndMeasurement::writeReport(QSettings *report, QString group, const SndMeasurementResult &result)
+{
+    report->beginGroup(group);
+    report->setValue("valid", result.valid);
+    report->setValue("fundamental_freq", result.fundamental_freq);
+    report->setValue("fundamental_amp", result.fundamental_amp);
+    report->setValue("peak", result.peak);
+    report->setValue("thd", result.thd);
+    report->setValue("thd_n", result.thd_n);
+    report->setValue("snr", result.snr);
+    report->setValue("sinad", result.sinad);
+    report->setValue("enob", result.enob);
+    report->setValue("sfdr", result.sfdr);
+    report->endGroup();
+}
+
+QString SndMeasurement::getReportFilename(QString sound_file)
+{
+    QFileInfo info(sound_file);
+    return info.path()+"/"+info.completeBaseName()+".report.ini";
+}
@@ -0,0 +1,63 @@
+#ifndef SNDMEASUREMENT_H
+#define SNDMEASUREMENT_H
+
+#include <math.h>
+#include <string.h>
+#include <QVector>
+#include <QString>
+#include <QSettings>
+#include <QFileInfo>
+#include "sndanalyzer.h"
+#include "sndringbuffer.h"
+#include "sndwavfile.h"
+
+/* thd and thd_n are ratios, snr, sinad and sfdr are in dB (sfdr in dBc), enob in bits */
+struct SndMeasurementResult {
+    bool valid;
+    double fundamental_freq;
+    double fundamental_amp;
+    double peak;
+    double thd, thd_n;
+    double snr, sinad, enob, sfdr;
+};
+
+/*
+    Distortion and noise figures of a tone, measured on Blackman-Harris windowed power
+    spectra averaged over one or more segments of equal length.
+*/
+class SndMeasurement
+{
+public:
+    SndMeasurement();
+    ~SndMeasurement();
+    unsigned int getHarmonicsCount() const;
+    void setHarmonicsCount(unsigned int value);
+    unsigned int getSegmentSize() const;
+    void setSegmentSize(unsigned int value);
+
+    void reset(double frequency);
+    void addSegment(const float *samples, unsigned int count);
+    SndMeasurementResult calculate();
+
+    SndMeasurementResult measure(const float *samples, unsigned int count, double frequency);
+    SndMeasurementResult measureTap(const SndRingBuffer *tap, unsigned int channel, unsigned int count, double frequency);
+    SndMeasurementResult measureFile(const SndWavFile *wav, unsigned int channel);
+    const QVector<HarmonicInfo> *getHarmonicLevels() const;
+
+    static QString toText(const SndMeasurementResult &result);
+    static void writeReport(QSettings *report, QString group, const SndMeasurementResult &result);
+    static QString getReportFilename(QString sound_file);
+private:
+    static const unsigned int lobe_bins = 4;
+    static const unsigned int max_file_segments = 32;
+    SndAnalyzer *analyzer;
+    unsigned int harmonics_count, segment_size;
+    QVector<double> power;
+    QVector<float> segment;
+    QVector<HarmonicInfo> harmonic_levels;
+    unsigned int segments_count, points;
+    double frequency, bin_freq, peak;
+    double lobePower(int center, int *from, int *to) const;
+};
+
+#endif // SNDMEASUREMENT_H
@@ -0,0 +1,63 @@
+#include "sndpcmconverter.h"
+
+/* soft clipping is linear up to this level */
+const double SndPcmConverter::soft_knee = 0.9;
+
+static const double pcm_full_scale = 2147483647.0;
+
+unsigned int SndPcmConverter::convert(const float *src, unsigned int count, qint32 *dest, unsigned int stride, SndClipMode mode)
+{
+    if (mode==SndClipSoft) return convertSoft(src, count, dest, stride);
+    return convertHard(src, count, dest, stride);
+}
+
+const char *SndPcmConverter::clipModeName(SndClipMode mode)
+{
+    return mode==SndClipSoft ? "soft" : "hard";
+}
+
+/*
+    Branch free: clamping, NaN handling and counting are selects, so the compiler
+    can vectorize the loop. NaN fails every comparison and becomes silence.
+*/
+unsigned int SndPcmConverter::convertHard(const float *src, unsigned int count, qint32 *dest, unsigned int stride)
+{
+    unsigned int i, clipped = 0;
+    float a, v;
+
+    for(i = 0; i<count; i++) {
+        a = src[i];
+        clipped += !(fabsf(a)<=1.0f);
+        v = a>1.0f ? 1.0f : a;
+        v = v<-1.0f ? -1.0f : v;
+        v = v==v ? v : 0.0f;
+        dest[i*stride] = (qint32) (v*pcm_full_scale);
+    }
+    return clipped;
+}
+
+/*
+    Above the knee: knee + (1-knee)*tanh((|x|-knee)/(1-knee)), which meets the
+    linear part with the same slope and approaches full scale without reaching it.
+*/
+unsigned int SndPcmConverter::convertSoft(const float *src, unsigned int count, qint32 *dest, unsigned int stride)
+{
+    unsigned int i, clipped = 0;
+    double a, range = 1-soft_knee;
+
+    for(i = 0; i<count; i++) {
+        a = src[i];
+        if (!(fabs(a)<=soft_knee)) {
+            if (!(fabs(a)<=1.0)) clipped++;
+            if (a!=a) {
+                a = 0;
+            } else if (a>0) {
+                a = soft_knee + range*tanh((a-soft_knee)/range);
+            } else {
+                a = -soft_knee - range*tanh((-a-soft_knee)/range);
+            }
+        }
+        dest[i*stride] = (qint32) (a*pcm_full_scale);
+    }
+    return clipped;
+}
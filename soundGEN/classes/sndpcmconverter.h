@@ -0,0 +1,29 @@
+#ifndef SNDPCMCONVERTER_H
+#define SNDPCMCONVERTER_H
+
+#include <math.h>
+#include <QtGlobal>
+
+/*
+    SndClipHard: samples beyond full scale are limited to full scale.
+    SndClipSoft: a tanh knee bends samples above soft_knee towards full scale.
+*/
+enum SndClipMode { SndClipHard, SndClipSoft };
+
+/*
+    Float to 32 bit PCM conversion that never overflows: the float to int cast
+    is undefined for |x| > 1 and wraps to INT_MIN on x86, which produced
+    full scale clicks. Both modes return how many samples were beyond full scale.
+*/
+class SndPcmConverter
+{
+public:
+    static unsigned int convert(const float *src, unsigned int count, qint32 *dest, unsigned int stride, SndClipMode mode);
+    static const char *clipModeName(SndClipMode mode);
+private:
+    static const double soft_knee;
+    static unsigned int convertHard(const float *src, unsigned int count, qint32 *dest, unsigned int stride);
+    static unsigned int convertSoft(const float *src, unsigned int count, qint32 *dest, unsigned int stride);
+};
+
+#endif // SNDPCMCONVERTER_H
@@ -0,0 +1,112 @@
+#include "sndringbuffer.h"
+
+SndRingBuffer::SndRingBuffer()
+{
+    data = 0;
+    channels_count = 0;
+    capacity = 0;
+    write_position.storeRelease(0);
+    max_block.storeRelease(0);
+}
+
+SndRingBuffer::~SndRingBuffer()
+{
+    if (data) delete[] data;
+}
+
+void SndRingBuffer::setFormat(unsigned int channels_count, unsigned int capacity)
+{
+    if (this->channels_count!=channels_count || this->capacity!=capacity) {
+        if (data) delete[] data;
+        data = 0;
+        this->channels_count = channels_count;
+        this->capacity = capacity;
+        if (channels_count*capacity>0) {
+            data = new float[channels_count*capacity];
+        }
+    }
+    reset();
+}
+
+void SndRingBuffer::reset(quint32 position)
+{
+    if (data) memset(data, 0, channels_count*capacity*sizeof(float));
+    max_block.storeRelease(0);
+    write_position.storeRelease((int) position);
+}
+
+unsigned int SndRingBuffer::getChannelsCount() const
+{
+    return channels_count;
+}
+
+unsigned int SndRingBuffer::getCapacity() const
+{
+    return capacity;
+}
+
+quint32 SndRingBuffer::getWritePosition() const
+{
+    return (quint32) write_position.loadAcquire();
+}
+
+void SndRingBuffer::write(unsigned int channel, const float *samples, unsigned int count)
+{
+    if (!data || channel>=channels_count) return;
+    if (count>capacity) {
+        samples += count-capacity;
+        count = capacity;
+    }
+    if ((int) count>max_block.loadAcquire()) {
+        max_block.storeRelease((int) count);
+    }
+
+    float *row = data + channel*capacity;
+    unsigned int start = ((quint32) write_position.loadAcquire()) % capacity;
+    unsigned int first = qMin(count, capacity-start);
+
+    memcpy(row+start, samples, first*sizeof(float));
+    if (first<count) {
+        memcpy(row, samples+first, (count-first)*sizeof(float));
+    }
+}
+
+void SndRingBuffer::commit(unsigned int count)
+{
+    write_position.storeRelease((int) (getWritePosition()+count));
+}
+
+bool SndRingBuffer::isAvailable(quint32 position, unsigned int count, quint32 end_position) const
+{
+    /*
+        Frames are valid if they are committed and the producer can't reach them
+        with the block it may be writing right now.
+    */
+    quint32 distance = end_position-position;
+    return distance>=count && distance<=capacity-(quint32) max_block.loadAcquire();
+}
+
+bool SndRingBuffer::read(unsigned int channel, quint32 position, float *dest, unsigned int count) const
+{
+    if (!data || channel>=channels_count || !count || count>capacity) return false;
+    if (!isAvailable(position, count, getWritePosition())) return false;
+
+    const float *row = data + channel*capacity;
+    unsigned int start = position % capacity;
+    unsigned int first = qMin(count, capacity-start);
+
+    memcpy(dest, row+start, first*sizeof(float));
+    if (first<count) {
+        memcpy(dest+first, row, (count-first)*sizeof(float));
+    }
+
+    /* full barrier: the copy above must complete before the position is checked again */
+    return isAvailable(position, count, (quint32) write_position.fetchAndAddOrdered(0));
+}
+
+bool SndRingBuffer::readLatest(unsigned int channel, float *dest, unsigned int count, quint32 *position) const
+{
+    quint32 start = getWritePosition()-count;
+    if (position) *position = start;
+    return read(channel, start, dest, count);
+}
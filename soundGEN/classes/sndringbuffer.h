@@ -0,0 +1,42 @@
+#ifndef SNDRINGBUFFER_H
+#define SNDRINGBUFFER_H
+
+#include <string.h>
+#include <QtGlobal>
+#include <QAtomicInt>
+
+/*
+    Single producer ring buffer of rendered samples (planar, one float row per channel).
+    The producer writes a block for every channel and then commits it.
+    Readers never block the producer: they copy a range of frames and check
+    afterwards that the producer did not overwrite it meanwhile.
+    Positions are absolute frame numbers modulo 2^32.
+*/
+class SndRingBuffer
+{
+public:
+    SndRingBuffer();
+    ~SndRingBuffer();
+    void setFormat(unsigned int channels_count, unsigned int capacity);
+    void reset(quint32 position = 0);
+    unsigned int getChannelsCount() const;
+    unsigned int getCapacity() const;
+    quint32 getWritePosition() const;
+
+    void write(unsigned int channel, const float *samples, unsigned int count);
+    void commit(unsigned int count);
+
+    bool read(unsigned int channel, quint32 position, float *dest, unsigned int count) const;
+    bool readLatest(unsigned int channel, float *dest, unsigned int count, quint32 *position = 0) const;
+private:
+    Q_DISABLE_COPY(SndRingBuffer)
+
+    float *data;
+    unsigned int channels_count;
+    unsigned int capacity;
+    mutable QAtomicInt write_position;
+    QAtomicInt max_block;
+    bool isAvailable(quint32 position, unsigned int count, quint32 end_position) const;
+};
+
+#endif // SNDRINGBUFFER_H
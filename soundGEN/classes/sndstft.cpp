@@ -0,0 +1,129 @@
+#include "sndstft.h"
+
+SndStft::SndStft()
+{
+    analyzer = new SndAnalyzer();
+    analyzer->setTop_harmonic(0);
+    analyzer->setWindow(SndWindowHann);
+    points = 2048;
+    hop = 512;
+    frequency = 44100;
+    position = 0;
+    tap_position = 0;
+    tap_synced = false;
+}
+
+SndStft::~SndStft()
+{
+    delete analyzer;
+}
+
+void SndStft::setFormat(unsigned int points, unsigned int hop, double frequency)
+{
+    this->points = qMax(points, 4u);
+    this->hop = qBound(1u, hop, this->points);
+    this->frequency = frequency;
+    reset(position);
+}
+
+unsigned int SndStft::getPoints() const
+{
+    return points;
+}
+
+unsigned int SndStft::getHop() const
+{
+    return hop;
+}
+
+double SndStft::getFrequency() const
+{
+    return frequency;
+}
+
+SndAnalyzerWindow SndStft::getWindow() const
+{
+    return analyzer->getWindow();
+}
+
+void SndStft::setWindow(SndAnalyzerWindow value)
+{
+    analyzer->setWindow(value);
+}
+
+void SndStft::addSubscriber(SndStftSubscriber *subscriber)
+{
+    if (!subscribers.contains(subscriber)) subscribers.append(subscriber);
+}
+
+void SndStft::removeSubscriber(SndStftSubscriber *subscriber)
+{
+    subscribers.removeAll(subscriber);
+}
+
+void SndStft::reset(quint32 position)
+{
+    pending.clear();
+    this->position = position;
+    tap_synced = false;
+}
+
+unsigned int SndStft::feed(const float *samples, unsigned int count)
+{
+    unsigned int offset = 0, frames = 0;
+    int i;
+
+    pending.reserve(points+count);
+    for(unsigned int j = 0; j<count; j++) {
+        pending.append(samples[j]);
+    }
+
+    while (pending.size()-offset>=points) {
+        analyzer->samples_fft_base(pending.constData()+offset, points, frequency);
+        for(i = 0; i<subscribers.size(); i++) {
+            subscribers.at(i)->stftFrame(position, analyzer->getHarmonics());
+        }
+        offset += hop;
+        position += hop;
+        frames++;
+    }
+
+    /* only the tail shorter than a frame is kept, so the move is bounded by points */
+    if (offset) pending.remove(0, qMin((int) offset, pending.size()));
+
+    return frames;
+}
+
+/*
+    Consumes the frames committed to the tap since the previous call.
+    If the reader fell behind the ring (or the tap was reset), it restarts
+    from the most recent frame instead of analysing stale audio.
+*/
+unsigned int SndStft::process(const SndRingBuffer *tap, unsigned int channel)
+{
+    unsigned int frames = 0, count;
+    quint32 write_position = tap->getWritePosition();
+    quint32 available = write_position - tap_position;
+
+    if (!tap_synced || available>tap->getCapacity()/2) {
+        if (write_position<points) return 0;
+        reset(write_position-points);
+        tap_position = write_position-points;
+        tap_synced = true;
+        available = points;
+    }
+
+    while (available>0) {
+        count = qMin(available, (quint32) qMax(points, 4096u));
+        if (tap_chunk.size()<(int) count) tap_chunk.resize(count);
+        if (!tap->read(channel, tap_position, tap_chunk.data(), count)) {
+            tap_synced = false;
+            break;
+        }
+        frames += feed(tap_chunk.constData(), count);
+        tap_position += count;
+        available -= count;
+    }
+
+    return frames;
+}
@@ -0,0 +1,54 @@
+#ifndef SNDSTFT_H
+#define SNDSTFT_H
+
+#include <QVector>
+#include <QList>
+#include "sndanalyzer.h"
+#include "sndringbuffer.h"
+
+class SndStftSubscriber
+{
+public:
+    virtual ~SndStftSubscriber() {}
+    /* position is the absolute frame number of the first sample of the analysed window */
+    virtual void stftFrame(quint32 position, const QVector<HarmonicInfo> *frame) = 0;
+};
+
+/*
+    Short-time Fourier transform over a sample stream.
+    Samples are consumed incrementally, a frame of points samples is analysed
+    every hop samples (overlap = 1 - hop/points) and passed to all subscribers.
+*/
+class SndStft
+{
+public:
+    SndStft();
+    ~SndStft();
+    void setFormat(unsigned int points, unsigned int hop, double frequency);
+    unsigned int getPoints() const;
+    unsigned int getHop() const;
+    double getFrequency() const;
+    SndAnalyzerWindow getWindow() const;
+    void setWindow(SndAnalyzerWindow value);
+
+    void addSubscriber(SndStftSubscriber *subscriber);
+    void removeSubscriber(SndStftSubscriber *subscriber);
+
+    void reset(quint32 position = 0);
+    unsigned int feed(const float *samples, unsigned int count);
+    unsigned int process(const SndRingBuffer *tap, unsigned int channel);
+private:
+    Q_DISABLE_COPY(SndStft)
+
+    SndAnalyzer *analyzer;
+    QList<SndStftSubscriber*> subscribers;
+    unsigned int points, hop;
+    double frequency;
+    QVector<float> pending;
+    quint32 position;
+    quint32 tap_position;
+    bool tap_synced;
+    QVector<float> tap_chunk;
+};
+
+#endif // SNDSTFT_H
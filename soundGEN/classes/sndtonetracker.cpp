@@ -0,0 +1,174 @@
+#include "sndtonetracker.h"
+
+SndToneTracker::SndToneTracker()
+{
+    frequency = 44100;
+    target_freq = 0;
+    harmonics_count = 4;
+    block_size = 0;
+    locked = false;
+    lock_count = 0;
+    result_freq = result_amp = result_peak = 0;
+    generation.storeRelease(0);
+    setFormat(44100, 1024);
+}
+
+void SndToneTracker::setFormat(double frequency, unsigned int block_size)
+{
+    unsigned int i;
+
+    this->frequency = frequency;
+    if (this->block_size!=block_size) {
+        this->block_size = block_size;
+        window.resize(block_size);
+        window_sum = 0;
+        for(i = 0; i<block_size; i++) {
+            window[i] = 0.5 - 0.5*cos(2*M_PI*i/block_size);
+            window_sum += window[i];
+        }
+    }
+    setTarget(target_freq, harmonics_count);
+}
+
+void SndToneTracker::setTarget(double target_freq, unsigned int harmonics_count)
+{
+    unsigned int h;
+
+    this->target_freq = target_freq;
+    this->harmonics_count = qMax(harmonics_count, 1u);
+
+    rot_r.resize(this->harmonics_count);
+    rot_i.resize(this->harmonics_count);
+    for(h = 0; h<this->harmonics_count; h++) {
+        double w = -2*M_PI*(h+1)*target_freq/frequency;
+        rot_r[h] = cos(w);
+        rot_i[h] = sin(w);
+    }
+    reset();
+}
+
+double SndToneTracker::getTarget() const
+{
+    return target_freq;
+}
+
+void SndToneTracker::reset()
+{
+    osc_r.fill(1, harmonics_count);
+    osc_i.fill(0, harmonics_count);
+    acc_r.fill(0, harmonics_count);
+    acc_i.fill(0, harmonics_count);
+    prev_phase.fill(0, harmonics_count);
+    has_prev = false;
+    locked = false;
+    lock_count = 0;
+    block_pos = 0;
+    block_energy = block_peak = 0;
+    publish();
+}
+
+void SndToneTracker::process(const float *samples, unsigned int count)
+{
+    unsigned int i, h;
+    double x, xw, r;
+    const double *w = window.constData();
+    double *or_ = osc_r.data(), *oi = osc_i.data();
+    double *ar = acc_r.data(), *ai = acc_i.data();
+    const double *rr = rot_r.constData(), *ri = rot_i.constData();
+
+    if (target_freq<=0 || target_freq*2>=frequency) return;
+
+    for(i = 0; i<count; i++) {
+        x = samples[i];
+        xw = x*w[block_pos];
+        block_energy += x*x;
+        if (fabs(x)>block_peak) block_peak = fabs(x);
+
+        for(h = 0; h<harmonics_count; h++) {
+            ar[h] += xw*or_[h];
+            ai[h] += xw*oi[h];
+            r     = or_[h]*rr[h] - oi[h]*ri[h];
+            oi[h] = or_[h]*ri[h] + oi[h]*rr[h];
+            or_[h] = r;
+        }
+
+        if (++block_pos==block_size) finishBlock();
+    }
+}
+
+void SndToneTracker::finishBlock()
+{
+    unsigned int h;
+    double amp, best_amp = -1, best_delta = 0, tone_energy = 0, phase, delta, norm;
+    /* maximal frequency offset resolvable from the phase advance of one block */
+    double block_freq = frequency/block_size;
+
+    for(h = 0; h<harmonics_count; h++) {
+        amp = 2*sqrt(acc_r[h]*acc_r[h] + acc_i[h]*acc_i[h]) / window_sum;
+        phase = atan2(acc_i[h], acc_r[h]);
+        tone_energy += amp*amp*0.5;
+        if (amp>best_amp) {
+            best_amp = amp;
+            /* the oscillator keeps absolute time, so a stable tone at the target has a constant phase */
+            delta = has_prev ? phase - prev_phase[h] : 0;
+            while (delta>M_PI)   delta -= 2*M_PI;
+            while (delta<=-M_PI) delta += 2*M_PI;
+            best_delta = delta;
+            result_freq = (h+1)*target_freq + delta/(2*M_PI)*block_freq;
+        }
+        prev_phase[h] = phase;
+
+        acc_r[h] = acc_i[h] = 0;
+        /* renormalize the recursive oscillator against rounding drift */
+        norm = sqrt(osc_r[h]*osc_r[h] + osc_i[h]*osc_i[h]);
+        osc_r[h] /= norm;
+        osc_i[h] /= norm;
+    }
+
+    /*
+        The phase advance is only known modulo 2*pi: a tone a whole block_freq away
+        gives the same delta. Such a tone falls on the slope of the window and loses
+        most of its energy, so the tracked components have to hold 80% of the block
+        energy and the advance has to stay within a quarter turn for several blocks.
+    */
+    if (has_prev && best_amp>0 && tone_energy >= 0.8*block_energy/block_size && fabs(best_delta)<M_PI/2) {
+        if (lock_count<lock_blocks) lock_count++;
+    } else {
+        lock_count = 0;
+    }
+    locked = lock_count>=lock_blocks;
+    result_amp = best_amp;
+    result_peak = block_peak;
+
+    has_prev = true;
+    block_pos = 0;
+    block_energy = block_peak = 0;
+    publish();
+}
+
+void SndToneTracker::publish()
+{
+    generation.fetchAndAddOrdered(1);
+    published.locked = locked;
+    published.freq = result_freq;
+    published.amp = result_amp;
+    published.peak = result_peak;
+    generation.fetchAndAddOrdered(1);
+}
+
+/*
+    Returns false if the result was being replaced during every attempt to read it,
+    the writer holds it only for a few stores.
+*/
+bool SndToneTracker::getResult(SndToneResult *result) const
+{
+    int before;
+    for(int attempt = 0; attempt<4; attempt++) {
+        before = generation.loadAcquire();
+        if (before & 1) continue;
+        *result = published;
+        /* full barrier: the copy above must be done before the generation is checked again */
+        if (generation.fetchAndAddOrdered(0)==before) return true;
+    }
+    return false;
+}
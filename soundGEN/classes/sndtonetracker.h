@@ -0,0 +1,56 @@
+#ifndef SNDTONETRACKER_H
+#define SNDTONETRACKER_H
+
+#include <math.h>
+#include <QVector>
+#include <QAtomicInt>
+
+struct SndToneResult {
+    bool locked;
+    double freq, amp, peak;
+};
+
+/*
+    Tracks a tone whose frequency is approximately known (the channel frequency)
+    without a full spectrum: the stream is demodulated at the target frequency
+    and its harmonics, one windowed DFT bin per harmonic and block.
+    The phase advance of a bin between consecutive blocks gives its exact frequency.
+    The rendering thread processes, any other thread may read the result of the
+    last block: it is published under a generation counter (odd while written).
+*/
+class SndToneTracker
+{
+public:
+    SndToneTracker();
+    void setFormat(double frequency, unsigned int block_size);
+    void setTarget(double target_freq, unsigned int harmonics_count);
+    double getTarget() const;
+    void reset();
+    void process(const float *samples, unsigned int count);
+
+    bool getResult(SndToneResult *result) const;
+private:
+    double frequency, target_freq;
+    unsigned int block_size, harmonics_count;
+    QVector<double> window;
+    double window_sum;
+
+    unsigned int block_pos;
+    QVector<double> rot_r, rot_i;
+    QVector<double> osc_r, osc_i;
+    QVector<double> acc_r, acc_i;
+    QVector<double> prev_phase;
+    bool has_prev;
+    double block_energy, block_peak;
+
+    static const unsigned int lock_blocks = 3;
+    bool locked;
+    unsigned int lock_count;
+    double result_freq, result_amp, result_peak;
+    SndToneResult published;
+    mutable QAtomicInt generation;
+    void publish();
+    void finishBlock();
+};
+
+#endif // SNDTONETRACKER_H
@@ -0,0 +1,174 @@
+#include "sndwavfile.h"
+
+static const quint16 wave_format_pcm = 1;
+static const quint16 wave_format_float = 3;
+static const quint16 wave_format_extensible = 0xFFFE;
+
+SndWavFile::SndWavFile()
+{
+    data = 0;
+    frames_count = 0;
+    channels_count = bits = block_align = 0;
+    frequency = 0;
+    sample_format = SndWavInt;
+}
+
+SndWavFile::~SndWavFile()
+{
+    close();
+}
+
+bool SndWavFile::fail(QString message)
+{
+    error = message;
+    close();
+    return false;
+}
+
+bool SndWavFile::open(QString filename)
+{
+    close();
+    error.clear();
+
+    file.setFileName(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+
+    qint64 size = file.size();
+    const uchar *map = size>12 ? file.map(0, size) : 0;
+    if (!map) {
+        return fail("Can't map file");
+    }
+    if (memcmp(map, "RIFF", 4)!=0 || memcmp(map+8, "WAVE", 4)!=0) {
+        return fail("Not a RIFF/WAVE file");
+    }
+
+    bool has_format = false;
+    quint16 format_tag = 0;
+    qint64 pos = 12;
+
+    while (pos+8<=size) {
+        const uchar *chunk = map+pos;
+        quint32 chunk_size = qFromLittleEndian<quint32>(chunk+4);
+        qint64 body = pos+8;
+
+        if (memcmp(chunk, "fmt ", 4)==0 && chunk_size>=16 && body+16<=size) {
+            format_tag     = qFromLittleEndian<quint16>(map+body);
+            channels_count = qFromLittleEndian<quint16>(map+body+2);
+            frequency      = qFromLittleEndian<quint32>(map+body+4);
+            block_align    = qFromLittleEndian<quint16>(map+body+12);
+            bits           = qFromLittleEndian<quint16>(map+body+14);
+            if (format_tag==wave_format_extensible && chunk_size>=26 && body+26<=size) {
+                /* first two bytes of the sub-format GUID hold the real format tag */
+                format_tag = qFromLittleEndian<quint16>(map+body+24);
+            }
+            has_format = true;
+        } else if (memcmp(chunk, "data", 4)==0) {
+            if (!has_format) {
+                return fail("Data chunk before format chunk");
+            }
+            /* exporters may leave the size unpatched, use what is actually in the file */
+            qint64 data_size = qMin((qint64) chunk_size, size-body);
+            if (chunk_size==0 || chunk_size==0xFFFFFFFF) data_size = size-body;
+            data = map+body;
+            frames_count = block_align ? data_size/block_align : 0;
+            break;
+        }
+        pos = body + chunk_size + (chunk_size & 1);
+    }
+
+    if (!data) {
+        return fail("No data chunk");
+    }
+    if (format_tag==wave_format_pcm && (bits==8 || bits==16 || bits==24 || bits==32)) {
+        sample_format = SndWavInt;
+    } else if (format_tag==wave_format_float && (bits==32 || bits==64)) {
+        sample_format = SndWavFloat;
+    } else {
+        return fail("Unsupported sample format");
+    }
+    if (!channels_count || block_align<channels_count*bits/8 || frequency<=0) {
+        return fail("Invalid format chunk");
+    }
+
+    return true;
+}
+
+void SndWavFile::close()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+    data = 0;
+    frames_count = 0;
+}
+
+bool SndWavFile::isOpen() const
+{
+    return data!=0;
+}
+
+QString SndWavFile::getError() const
+{
+    return error;
+}
+
+unsigned int SndWavFile::getChannelsCount() const
+{
+    return channels_count;
+}
+
+double SndWavFile::getFrequency() const
+{
+    return frequency;
+}
+
+unsigned int SndWavFile::getBitsPerSample() const
+{
+    return bits;
+}
+
+quint64 SndWavFile::getFramesCount() const
+{
+    return frames_count;
+}
+
+/*
+    Converts count frames of one channel to float in -1..1, returns the number of frames read.
+*/
+unsigned int SndWavFile::read(unsigned int channel, quint64 frame, float *dest, unsigned int count) const
+{
+    unsigned int i;
+
+    if (!data || channel>=channels_count || frame>=frames_count) return 0;
+    if (frame+count>frames_count) count = frames_count-frame;
+
+    unsigned int sample_size = bits/8;
+    const uchar *src = data + frame*block_align + channel*sample_size;
+
+    for(i = 0; i<count; i++, src += block_align) {
+        if (sample_format==SndWavFloat) {
+            if (bits==32) {
+                quint32 v = qFromLittleEndian<quint32>(src);
+                float f;
+                memcpy(&f, &v, sizeof(f));
+                dest[i] = f;
+            } else {
+                quint64 v = qFromLittleEndian<quint64>(src);
+                double d;
+                memcpy(&d, &v, sizeof(d));
+                dest[i] = d;
+            }
+        } else {
+            switch (bits) {
+            case 8:  dest[i] = (src[0]-128) / 128.0f; break;
+            case 16: dest[i] = qFromLittleEndian<qint16>(src) / 32768.0f; break;
+            case 24: dest[i] = (qint32) ((quint32) src[0]<<8 | (quint32) src[1]<<16 | (quint32) src[2]<<24) / 2147483648.0f; break;
+            default: dest[i] = qFromLittleEndian<qint32>(src) / 2147483648.0f; break;
+            }
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,44 @@
+#ifndef SNDWAVFILE_H
+#define SNDWAVFILE_H
+
+#include <string.h>
+#include <QFile>
+#include <QString>
+#include <QtEndian>
+
+enum SndWavSampleFormat { SndWavInt, SndWavFloat };
+
+/*
+    Read-only RIFF/WAVE reader over a memory-mapped file.
+    Supports integer PCM of 8/16/24/32 bits and 32/64 bit float, including WAVE_FORMAT_EXTENSIBLE.
+*/
+class SndWavFile
+{
+public:
+    SndWavFile();
+    ~SndWavFile();
+    bool open(QString filename);
+    void close();
+    bool isOpen() const;
+    QString getError() const;
+
+    unsigned int getChannelsCount() const;
+    double getFrequency() const;
+    unsigned int getBitsPerSample() const;
+    quint64 getFramesCount() const;
+
+    unsigned int read(unsigned int channel, quint64 frame, float *dest, unsigned int count) const;
+private:
+    Q_DISABLE_COPY(SndWavFile)
+
+    QFile file;
+    const uchar *data;
+    quint64 frames_count;
+    unsigned int channels_count, bits, block_align;
+    double frequency;
+    SndWavSampleFormat sample_format;
+    QString error;
+    bool fail(QString message);
+};
+
+#endif // SNDWAVFILE_H
@@ -0,0 +1,180 @@
+#include "waveformthread.h"
+
+WaveformThread *WaveformThread::_self_thread = 0;
+int WaveformThread::links_count = 0;
+
+bool WaveformParams::operator==(const WaveformParams &other) const
+{
+    return fct==other.fct && tfct==other.tfct && t==other.t && dt==other.dt
+            && freq==other.freq && columns==other.columns;
+}
+
+bool WaveformParams::operator!=(const WaveformParams &other) const
+{
+    return !(*this==other);
+}
+
+WaveformCache::WaveformCache(QObject *parent) :
+    QObject(parent)
+{
+    has_request = has_result = false;
+    thread = WaveformThread::addCache(this);
+}
+
+WaveformCache::~WaveformCache()
+{
+    WaveformThread::removeCache(this);
+}
+
+/*
+    Only the newest request is kept, a request equal to the pending or
+    computed one is ignored.
+*/
+void WaveformCache::request(const WaveformParams &params)
+{
+    mutex.lock();
+    bool changed = has_request ? requested!=params : (!has_result || computed!=params);
+    if (changed) {
+        requested = params;
+        has_request = true;
+    }
+    mutex.unlock();
+
+    if (changed) thread->schedule(this);
+}
+
+/*
+    Blocks until the thread has finished with this cache, after that
+    no function passed in a request is called anymore.
+*/
+void WaveformCache::cancel()
+{
+    thread->unschedule(this);
+    mutex.lock();
+    has_request = has_result = false;
+    result.clear();
+    mutex.unlock();
+}
+
+bool WaveformCache::getResult(WaveformParams *params, QVector<float> *minmax)
+{
+    QMutexLocker locker(&mutex);
+    if (!has_result) return false;
+    *params = computed;
+    *minmax = result;
+    return true;
+}
+
+WaveformThread::WaveformThread(QObject *parent) :
+    QThread(parent)
+{
+    current = 0;
+    stop = false;
+}
+
+WaveformThread *WaveformThread::addCache(WaveformCache *cache)
+{
+    Q_UNUSED(cache);
+    if (!_self_thread) {
+        _self_thread = new WaveformThread();
+        _self_thread->start(QThread::LowPriority);
+    }
+    links_count++;
+    return _self_thread;
+}
+
+void WaveformThread::removeCache(WaveformCache *cache)
+{
+    if (!_self_thread) return;
+
+    _self_thread->unschedule(cache);
+    if (--links_count<=0) {
+        _self_thread->mutex.lock();
+        _self_thread->stop = true;
+        _self_thread->wake.wakeAll();
+        _self_thread->mutex.unlock();
+        _self_thread->wait();
+        delete _self_thread;
+        _self_thread = 0;
+        links_count = 0;
+    }
+}
+
+void WaveformThread::schedule(WaveformCache *cache)
+{
+    QMutexLocker locker(&mutex);
+    if (!queue.contains(cache)) queue.append(cache);
+    wake.wakeOne();
+}
+
+void WaveformThread::unschedule(WaveformCache *cache)
+{
+    QMutexLocker locker(&mutex);
+    queue.removeAll(cache);
+    while (current==cache) {
+        idle.wait(&mutex);
+    }
+}
+
+void WaveformThread::run()
+{
+    WaveformParams params;
+    QVector<float> minmax;
+
+    mutex.lock();
+    while (!stop) {
+        if (queue.isEmpty()) {
+            wake.wait(&mutex);
+            continue;
+        }
+        current = queue.takeFirst();
+        mutex.unlock();
+
+        current->mutex.lock();
+        bool has_request = current->has_request;
+        params = current->requested;
+        current->has_request = false;
+        current->mutex.unlock();
+
+        if (has_request) {
+            compute(params, &minmax);
+
+            current->mutex.lock();
+            current->computed = params;
+            current->result.swap(minmax);
+            current->has_result = true;
+            current->mutex.unlock();
+            /* queued to the GUI thread, unschedule() waits until this returns */
+            emit current->ready();
+        }
+
+        mutex.lock();
+        current = 0;
+        idle.wakeAll();
+    }
+    mutex.unlock();
+}
+
+void WaveformThread::compute(const WaveformParams &params, QVector<float> *minmax)
+{
+    int c, j;
+    int points = params.columns*samples_per_column;
+    double k_t = params.dt/points;
+    double k_freq = params.freq*2.0*M_PI;
+    float v, v_min, v_max;
+
+    minmax->resize(2*qMax(params.columns, 0));
+    float *out = minmax->data();
+
+    for(c = 0; c<params.columns; c++) {
+        v_min = v_max = 0;
+        for(j = 0; j<samples_per_column; j++) {
+            double t = params.t + (c*samples_per_column + j)*k_t;
+            v = params.fct ? params.fct(t, k_freq, params.freq) : (params.tfct ? params.tfct(k_freq*t) : 0);
+            if (!j || v<v_min) v_min = v;
+            if (!j || v>v_max) v_max = v;
+        }
+        out[2*c] = v_min;
+        out[2*c+1] = v_max;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef WAVEFORMTHREAD_H
+#define WAVEFORMTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QList>
+#include "../abstractsndcontroller.h"
+#include "../base_functions.h"
+
+struct WaveformParams {
+    GenSoundFunction fct;
+    base_function_signal tfct;
+    double t, dt, freq;
+    int columns;
+    bool operator==(const WaveformParams &other) const;
+    bool operator!=(const WaveformParams &other) const;
+};
+
+class WaveformThread;
+
+/*
+    Min/max of a function for every pixel column, computed by the shared WaveformThread.
+    Values are not scaled, so amplitude or height changes don't need a new evaluation.
+    Channel functions are called here while the audio thread renders them: this relies
+    on the sample cursors of the generated library being thread local (see
+    SoundList::getHeaderText); the generated helpers keep no other state.
+*/
+class WaveformCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WaveformCache(QObject *parent = 0);
+    ~WaveformCache();
+    void request(const WaveformParams &params);
+    void cancel();
+    bool getResult(WaveformParams *params, QVector<float> *minmax);
+private:
+    friend class WaveformThread;
+    WaveformThread *thread;
+    QMutex mutex;
+    WaveformParams requested, computed;
+    bool has_request, has_result;
+    QVector<float> result;
+signals:
+    void ready();
+};
+
+class WaveformThread : public QThread
+{
+    Q_OBJECT
+public:
+    static WaveformThread *addCache(WaveformCache *cache);
+    static void removeCache(WaveformCache *cache);
+    void schedule(WaveformCache *cache);
+    void unschedule(WaveformCache *cache);
+protected:
+    void run();
+private:
+    static const int samples_per_column = 4;
+    static WaveformThread *_self_thread;
+    static int links_count;
+    explicit WaveformThread(QObject *parent = 0);
+
+    QMutex mutex;
+    QWaitCondition wake, idle;
+    QList<WaveformCache*> queue;
+    WaveformCache *current;
+    bool stop;
+    QVector<float> buffer;
+    void compute(const WaveformParams &params, QVector<float> *minmax);
+};
+
+#endif // WAVEFORMTHREAD_H
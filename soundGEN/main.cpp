@@ -1,9 +1,18 @@
 #include "mainwindow.h"
 #include <QApplication>
 #include <QTranslator>
+#include "classes/sndbatchanalyzer.h"
 
 int main(int argc, char *argv[])
 {
+    /* headless batch analysis, see SndBatchAnalyzer::runCommandLine */
+    for(int i=1; i<argc; i++) {
+        if (QString(argv[i])=="--analyze") {
+            QCoreApplication core_app(argc, argv);
+            return SndBatchAnalyzer::runCommandLine(core_app.arguments().mid(1));
+        }
+    }
+
     QApplication app(argc, argv);
 
     #if !defined(__ANDROID__)
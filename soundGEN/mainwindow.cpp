@@ -38,6 +38,11 @@ MainWindow::MainWindow(QWidget *parent) :
     QObject::connect(sc, SIGNAL(stopped()), this, SLOT(sound_stopped()));
     QObject::connect(sc, SIGNAL(started()), this, SLOT(sound_started()));
     QObject::connect(sc, SIGNAL(write_message(QString)), this, SLOT(get_message(QString)));
+    /* dropped frames are counted in the status bar instead of flooding it with messages */
+    frames_label = new QLabel(this);
+    frames_label->setVisible(false);
+    ui->statusBar->addPermanentWidget(frames_label);
+    QObject::connect(FrameScheduler::Instance(), SIGNAL(framesDropped(int,int)), this, SLOT(frames_dropped(int,int)));
 
     QObject::connect(functions_text, SIGNAL(textChangedC()), this, SLOT(options_changing()));
 }
@@ -55,6 +60,13 @@ void MainWindow::get_message(QString message)
     ui->statusBar->showMessage(message, 5000);
 }
 
+void MainWindow::frames_dropped(int count, int interval)
+{
+    Q_UNUSED(count);
+    frames_label->setText(tr("Dropped frames: %1, %2 ms").arg(FrameScheduler::Instance()->getDroppedFrames()).arg(interval));
+    frames_label->setVisible(true);
+}
+
 void MainWindow::doSetParams()
 {
     emit fill_params();
@@ -81,6 +93,7 @@ void MainWindow::sound_stopped()
     ui->action8->setEnabled(true);
 
     ui->actionOpen->setEnabled(true);
+    ui->actionMeasure_channels->setEnabled(false);
     emit stop_channel_graphics();
 
     if (auto_restart && !close_on_stop) {
@@ -109,6 +122,7 @@ void MainWindow::sound_started()
     ui->action8->setEnabled(false);
 
     ui->actionOpen->setEnabled(false);
+    ui->actionMeasure_channels->setEnabled(true);
 
     emit run_channel_graphics();
 }
@@ -191,6 +205,7 @@ void MainWindow::save_settings(QString filename, bool base_settings)
     int i;
 
     settings.setValue("main/channels_count", sc->getChannelsCount());
+    settings.setValue("main/soft_clip", sc->getClipMode()==SndClipSoft);
     for(i=0; i<sc->getChannelsCount(); i++) {
         settings.setValue("main/function_"+QString::number(i), channels.at(i)->getFunction());
         settings.setValue("main/amp_"+QString::number(i), channels.at(i)->getAmp());
@@ -199,7 +214,13 @@ void MainWindow::save_settings(QString filename, bool base_settings)
         settings.setValue("graphic/dt_"+QString::number(i), channels.at(i)->getDrawer()->getDtIntValue());
         settings.setValue("graphic/group_"+QString::number(i), channels.at(i)->getDrawer()->isGrouped());
         settings.setValue("graphic/fft_"+QString::number(i), channels.at(i)->getDrawer()->isFft());
+        settings.setValue("graphic/spectrogram_"+QString::number(i), channels.at(i)->getDrawer()->isSpectrogram());
         settings.setValue("graphic/dt_fft_"+QString::number(i), channels.at(i)->getDrawer()->getDtFftIntValue());
+        settings.setValue("graphic/fft_average_"+QString::number(i), channels.at(i)->getDrawer()->getFftAverageMode());
+        settings.setValue("graphic/fft_scale_"+QString::number(i), channels.at(i)->getDrawer()->getFftScale());
+        settings.setValue("graphic/scope_"+QString::number(i), channels.at(i)->getDrawer()->isScope());
+        settings.setValue("graphic/trigger_"+QString::number(i), channels.at(i)->getDrawer()->getTrigger());
+        settings.setValue("graphic/trigger_level_"+QString::number(i), channels.at(i)->getDrawer()->getTriggerLevel());
     }
 
     SoundPicker *picker;
@@ -259,6 +280,7 @@ void MainWindow::load_settings(QString filename, bool base_settings)
     int channels_cnt = settings.value("main/channels_count", 2).toInt();
     if (channels_cnt<=0 || channels_cnt>8) channels_cnt=2;
     pickChannelsCount(channels_cnt);
+    ui->actionSoft_clipping->setChecked(settings.value("main/soft_clip", false).toBool());
 
     for(i=0; i<sc->getChannelsCount(); i++) {
         channels.at(i)->setFunction(settings.value("main/function_"+QString::number(i), "sin(k*t)").toString());
@@ -268,7 +290,13 @@ void MainWindow::load_settings(QString filename, bool base_settings)
         channels.at(i)->getDrawer()->setDtIntValue(settings.value("graphic/dt_"+QString::number(i), 300).toDouble());
         channels.at(i)->getDrawer()->setGrouped(settings.value("graphic/group_"+QString::number(i), true).toBool());
         channels.at(i)->getDrawer()->setFft(settings.value("graphic/fft_"+QString::number(i), false).toBool());
+        channels.at(i)->getDrawer()->setSpectrogram(settings.value("graphic/spectrogram_"+QString::number(i), false).toBool());
         channels.at(i)->getDrawer()->setDtFftIntValue(settings.value("graphic/dt_fft_"+QString::number(i), 100).toDouble());
+        channels.at(i)->getDrawer()->setFftAverageMode(settings.value("graphic/fft_average_"+QString::number(i), 0).toInt());
+        channels.at(i)->getDrawer()->setFftScale(settings.value("graphic/fft_scale_"+QString::number(i), 0).toInt());
+        channels.at(i)->getDrawer()->setScope(settings.value("graphic/scope_"+QString::number(i), false).toBool());
+        channels.at(i)->getDrawer()->setTrigger(settings.value("graphic/trigger_"+QString::number(i), ScopeTriggerRising).toInt());
+        channels.at(i)->getDrawer()->setTriggerLevel(settings.value("graphic/trigger_level_"+QString::number(i), 0).toDouble());
     }
 
     if (base_settings) {
@@ -420,13 +448,25 @@ void MainWindow::channel_options_changing(int channel_index)
         int dt = channels.at(channel_index)->getDrawer()->getDtIntValue();
         int kamp = channels.at(channel_index)->getDrawer()->getKampIntValue();
         bool is_fft = channels.at(channel_index)->getDrawer()->isFft();
+        bool is_spectrogram = channels.at(channel_index)->getDrawer()->isSpectrogram();
         int fft_dt = channels.at(channel_index)->getDrawer()->getDtFftIntValue();
+        int fft_average = channels.at(channel_index)->getDrawer()->getFftAverageMode();
+        int fft_scale = channels.at(channel_index)->getDrawer()->getFftScale();
+        bool is_scope = channels.at(channel_index)->getDrawer()->isScope();
+        int trigger = channels.at(channel_index)->getDrawer()->getTrigger();
+        double trigger_level = channels.at(channel_index)->getDrawer()->getTriggerLevel();
         for(int i = 0; i<channels.length(); i++) {
             if (i!=channel_index && channels.at(i)->getDrawer()->isGrouped()) {
                 channels.at(i)->getDrawer()->setDtIntValue(dt);
                 channels.at(i)->getDrawer()->setKampIntValue(kamp);
                 channels.at(i)->getDrawer()->setDtFftIntValue(fft_dt);
+                channels.at(i)->getDrawer()->setFftAverageMode(fft_average);
+                channels.at(i)->getDrawer()->setFftScale(fft_scale);
                 channels.at(i)->getDrawer()->setFft(is_fft);
+                channels.at(i)->getDrawer()->setSpectrogram(is_spectrogram);
+                channels.at(i)->getDrawer()->setTrigger(trigger);
+                channels.at(i)->getDrawer()->setTriggerLevel(trigger_level);
+                channels.at(i)->getDrawer()->setScope(is_scope);
             }
         }
     }
@@ -497,8 +537,55 @@ void MainWindow::on_action8_triggered()
     pickChannelsCount(8);
 }
 
+void MainWindow::on_actionSoft_clipping_toggled(bool checked)
+{
+    sc->setClipMode(checked ? SndClipSoft : SndClipHard);
+}
+
+void MainWindow::on_actionGo_to_time_triggered()
+{
+    bool ok;
+    double seconds = QInputDialog::getDouble(this, tr("Go to time"), tr("Time, s:"), sc->getT(), 0, 86400, 6, &ok);
+    if (ok) sc->seek(seconds);
+}
+
 void MainWindow::on_actionExport_to_triggered()
 {
     doSetParams();
     export_form->exec();
 }
+
+void MainWindow::on_actionMeasure_channels_triggered()
+{
+    /* the tap is reallocated while playback starts */
+    if (!sc->running()) return;
+
+    SndMeasurement measurement;
+    QString text;
+    unsigned int count = sc->getFrequency();
+
+    for(unsigned int i=0; i<sc->getChannelsCount(); i++) {
+        SndMeasurementResult result = measurement.measureTap(sc->getTap(), i, count, sc->getFrequency());
+        text += tr("Channel ") + QString::number(i) + "\n" + SndMeasurement::toText(result) + "\n\n";
+    }
+    QMessageBox::information(this, tr("Measure channels"), text, QMessageBox::Ok, QMessageBox::Ok);
+}
+
+void MainWindow::on_actionMeasure_file_triggered()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open sound file"), EnvironmentInfo::getHomePath(), tr("Sound file (*.wav)"));
+    if (fileName.isEmpty()) return;
+
+    SndWavFile wav;
+    if (!wav.open(fileName)) {
+        QMessageBox::critical(this, tr("Measure sound file"), wav.getError(), QMessageBox::Ok, QMessageBox::Ok);
+        return;
+    }
+
+    SndMeasurement measurement;
+    QString text;
+    for(unsigned int i=0; i<wav.getChannelsCount(); i++) {
+        text += tr("Channel ") + QString::number(i) + "\n" + SndMeasurement::toText(measurement.measureFile(&wav, i)) + "\n\n";
+    }
+    QMessageBox::information(this, tr("Measure sound file"), text, QMessageBox::Ok, QMessageBox::Ok);
+}
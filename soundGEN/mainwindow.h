@@ -6,11 +6,15 @@
 #include <QFileDialog>
 #include <QPushButton>
 #include <QMessageBox>
+#include <QInputDialog>
+#include <QLabel>
 #include "sndcontroller.h"
 #include "widgets/soundpicker.h"
 #include "widgets/channelsettings.h"
 #include "widgets/dialogexport.h"
 #include "classes/utextedit.h"
+#include "classes/sndmeasurement.h"
+#include "classes/framescheduler.h"
 
 namespace Ui {
 class MainWindow;
@@ -41,6 +45,8 @@ private slots:
 
     void get_message(QString message);
 
+    void frames_dropped(int count, int interval);
+
     void on_MainWindow_destroyed();
 
     void on_buttonBox_clicked(QAbstractButton *button);
@@ -71,6 +77,14 @@ private slots:
 
     void on_actionExport_to_triggered();
 
+    void on_actionMeasure_channels_triggered();
+
+    void on_actionMeasure_file_triggered();
+
+    void on_actionSoft_clipping_toggled(bool checked);
+
+    void on_actionGo_to_time_triggered();
+
 private:
     static const int maxSounds = 10;
     Ui::MainWindow *ui;
@@ -84,6 +98,7 @@ private:
     UTextEdit *functions_text;
     UTextEdit *dialog_for_edit;
     DialogExport *export_form;
+    QLabel *frames_label;
 
     void removeSoundPicker(SoundPicker* p);
     void adjustSoundParams();
@@ -1,6 +1,9 @@
 #include "sndcontroller.h"
 
 SndController *SndController::_self_controller = 0;
+/* Blackman-Harris window with Gaussian interpolation resolves frequency far below the 10 Hz bin spacing */
+const double SndController::analysis_seconds = 0.1;
+const double SndController::loudness_true_peak_limit = -1.0;
 
 
 FMOD_RESULT F_CALLBACK pcmreadcallback(FMOD_SOUND *sound, void *data, unsigned int datalen)
@@ -12,8 +15,12 @@ FMOD_RESULT F_CALLBACK pcmreadcallback(FMOD_SOUND *sound, void *data, unsigned i
 FMOD_RESULT F_CALLBACK pcmsetposcallback(FMOD_SOUND *sound, int subsound, unsigned int position, FMOD_TIMEUNIT postype)
 {
     /*
-        This is useful if the user calls Sound::setPosition and you want to seek your data accordingly.
+        The stream is a one second loop, so its own positions can't address the signal:
+        the process thread takes a seek requested by SndController::seek() and rewinds the
+        channel to flush buffered data, the frame is applied here before the next block is
+        rendered. Loop restarts leave the position as it is.
     */
+    SndController::Instance()->applySeek();
     return FMOD_OK;
 }
 
@@ -29,6 +36,22 @@ SndController::SndController(QObject *parent) :
     timer = new QTimer();
     analyzer = new SndAnalyzer();
     analyzer->setTop_harmonic(1);
+    analyzer->setFft_size(SndFftExact);
+    analyzer->setWindow(SndWindowBlackmanHarris);
+    analyzer->setInterpolation(SndInterpolationGaussian);
+    tap = new SndRingBuffer();
+    meter = new SndLevelMeter();
+    clip_mode = SndClipHard;
+    export_normalize = SndNormalizeNone;
+    export_normalize_target = 0;
+    output_gain = 1;
+    export_source_loudness = export_source_true_peak = 0;
+    export_from_frame = export_frames = 0;
+    frame_position = 0;
+    seek_seconds = 0;
+    seek_frame = 0;
+    seek_pending.storeRelease(0);
+    seek_apply.storeRelease(0);
     all_functions_loaded = false;
     channels_count = 0;
     frequency = 0;
@@ -95,6 +118,8 @@ SndController::~SndController()
     delete timer;
     delete baseSoundList;
     delete analyzer;
+    delete tap;
+    delete meter;
     delete process_thread;
 }
 
@@ -129,6 +154,8 @@ void SndController::setChannelsCount(unsigned int count)
         while (count>=0 && count<channels.size()) {
             delete channels.last();
             channels.remove(channels.size()-1);
+            delete trackers.last();
+            trackers.remove(trackers.size()-1);
         }
     } else if (count>channels.size()) {
         while (count>channels.size()) {
@@ -141,6 +168,7 @@ void SndController::setChannelsCount(unsigned int count)
             info->fr = 0;
             info->ar = 0;
             channels.append(info);
+            trackers.append(new SndToneTracker());
         }
     }
 
@@ -159,29 +187,72 @@ unsigned int SndController::getChannelsCount()
 
 void SndController::fillBuffer(FMOD_SOUND *sound, void *data, unsigned int datalen)
 {
-    unsigned int  count;
     qint32 *buffer = (qint32*)data;
-    qint32 max_val = std::numeric_limits<qint32>::max();
 
     datalen = datalen/(channels_count*sizeof(qint32));
 
     if (all_functions_loaded)
     {
+        if (tap_block.size()<datalen) tap_block.resize(datalen);
+        float *block = tap_block.data();
+
         for(unsigned int i=0; i<channels_count; i++)
         {
-            double curr = 0;
-
-            for (count=0; count<datalen; count++)
-            {
-                curr = getResult(i, t+count/frequency);
-                buffer[count*channels_count + i] = (qint32)(curr * max_val);
+            renderChannel(i, block, datalen);
+            clipped_samples[i] += SndPcmConverter::convert(block, datalen, buffer+i, channels_count, clip_mode);
+            tap->write(i, block, datalen);
+            meter->process(i, block, datalen);
+
+            if (process_mode == SndPlay) {
+                SndToneTracker *tracker = trackers.at(i);
+                if (tracker->getTarget()!=channels.at(i)->freq) {
+                    tracker->setTarget(channels.at(i)->freq, tracker_harmonics);
+                }
+                tracker->process(block, datalen);
             }
         }
+        tap->commit(datalen);
+        meter->commit(datalen);
 
-        t += datalen/frequency;
+        setFramePosition(frame_position + datalen);
     }
 }
 
+/*
+    Time is derived from the frame counter, so it is exact at any position
+    instead of accumulating rounding errors of datalen/frequency.
+*/
+void SndController::setFramePosition(quint64 frame)
+{
+    frame_position = frame;
+    t = frame/frequency;
+}
+
+/*
+    While stopped the time becomes the start position of the next playback.
+*/
+void SndController::seek(double seconds)
+{
+    if (seconds<0) seconds = 0;
+    seek_seconds = seconds;
+    seek_pending.storeRelease(1);
+    if (is_running) loop->exit();
+}
+
+/*
+    Called by pcmsetposcallback in the rendering thread. The tap and the meters are
+    rebased, so their positions stay the absolute frame numbers that the views
+    derive from getT().
+*/
+void SndController::applySeek()
+{
+    if (!seek_apply.fetchAndStoreOrdered(0)) return;
+    setFramePosition(seek_frame);
+    tap->reset((quint32) seek_frame);
+    meter->reset((quint32) seek_frame);
+    for(int i=0; i<trackers.size(); i++) trackers.at(i)->reset();
+}
+
 QString SndController::getCurrentParseHash()
 {
     QCryptographicHash hash(QCryptographicHash::Sha1);
@@ -194,6 +265,7 @@ QString SndController::getCurrentParseHash()
     #endif
     hash.addData(QString::number(channels_count).toLatin1());
     hash.addData(QString::number(lib.isLoaded()).toLatin1());
+    hash.addData(QString::number(baseSoundList->getSoundsCount()).toLatin1());
     hash.addData(sound_functions.toLatin1());
     hash.addData(text_functions.toLatin1());
     for(int i=0;i<channels_count;i++) {
@@ -290,8 +362,9 @@ bool SndController::parseFunctions()
     out << "#include <stdio.h>\n";
     if (add_base_functions) out << "#include \"base_functions.h\"\n";
     out << "typedef double (*PlaySoundFunction) (int,unsigned int,double);\n";
+    out << baseSoundList->getHeaderText();
     for(i=0;i<channels_count;i++) {
-        out << spec_func_pref << " double sound_func_"+QString::number(i)+"(double t, double k, double f, PlaySoundFunction __bFunction);\n";
+        out << spec_func_pref << " double sound_func_"+QString::number(i)+"(double t, double k, double f);\n";
     }
     file.close();
 
@@ -301,10 +374,22 @@ bool SndController::parseFunctions()
     out2 << "#include \"main.h\"\n";
     out2 << spec_namespace;
     out2 << "\nPlaySoundFunction BaseSoundFunction;\n";
+    out2 << "static SoundDescriptor __sound_descriptors["+QString::number(qMax(1, baseSoundList->getSoundsCount()))+"];\n";
+    out2 << "static __SOUND_THREAD_LOCAL SoundCursor __sound_cursors["+QString::number(channels_count+1)+"]["+QString::number(qMax(1, baseSoundList->getSoundsCount()))+"];\n";
+    out2 << "#define __SOUND_CHANNEL "+QString::number(channels_count)+"\n";
+    out2 << spec_func_pref << " void sound_init(PlaySoundFunction __bFunction, const SoundDescriptor *sounds, unsigned int count) {\n";
+    out2 << "    BaseSoundFunction = __bFunction;\n";
+    out2 << "    if (count>sizeof(__sound_descriptors)/sizeof(SoundDescriptor)) count = sizeof(__sound_descriptors)/sizeof(SoundDescriptor);\n";
+    out2 << "    memset(__sound_descriptors, 0, sizeof(__sound_descriptors));\n";
+    out2 << "    memset(__sound_cursors, 0, sizeof(__sound_cursors));\n";
+    out2 << "    if (count) memcpy(__sound_descriptors, sounds, count*sizeof(SoundDescriptor));\n";
+    out2 << "};\n";
     out2 << "\n" + sound_functions + "\n";
     out2 << "\n" + text_functions + "\n";
     for(i=0;i<channels_count;i++) {
-        out2 << spec_func_pref << "double sound_func_"+QString::number(i)+"(double t, double k, double f, PlaySoundFunction __bFunction) { BaseSoundFunction=__bFunction; return (double) ("+channels.at(i)->function_text+"); };\n";
+        out2 << "#undef __SOUND_CHANNEL\n";
+        out2 << "#define __SOUND_CHANNEL "+QString::number(i)+"\n";
+        out2 << spec_func_pref << " double sound_func_"+QString::number(i)+"(double t, double k, double f) { return (double) ("+channels.at(i)->function_text+"); };\n";
     }
     out2 << "int main() {return 0;};\n";
     file2.close();
@@ -324,15 +409,15 @@ bool SndController::parseFunctions()
         qDebug() << pConsoleProc->workingDirectory() << endl;
 
         if (add_base_functions) {
-            pConsoleProc->start("cl.exe /c /EHsc base_functions.cpp");
+            pConsoleProc->start("cl.exe /c /O2 /EHsc base_functions.cpp");
             pConsoleProc->waitForFinished();
             qDebug() <<  pConsoleProc->readAll() << endl;
             pConsoleProc->start("lib base_functions.obj");
             pConsoleProc->waitForFinished();
             qDebug() <<  pConsoleProc->readAll() << endl;
-            tcmd = "cl.exe /LD main.cpp /DLL /link base_functions.lib /OUT:" + lib_file;
+            tcmd = "cl.exe /O2 /LD main.cpp /DLL /link base_functions.lib /OUT:" + lib_file;
         } else {
-            tcmd = "cl.exe /LD main.cpp /link /DLL /OUT:" + lib_file;
+            tcmd = "cl.exe /O2 /LD main.cpp /link /DLL /OUT:" + lib_file;
         }
     #else
         QFile file3(EnvironmentInfo::getConfigsPath()+"/efr/Makefile");
@@ -347,9 +432,9 @@ bool SndController::parseFunctions()
         out3 << lib_file+":$(MODULES)\n";
         out3 << "	$(CC) -shared $(MODULES) -o "+lib_file+"\n";
         out3 << "base_functions.o: $(RCLOBJECTS)\n";
-        out3 << "	g++ -m64 -Wall -fPIC -c base_functions.cpp -o base_functions.o\n";
+        out3 << "	g++ -m64 -O2 -Wall -fPIC -c base_functions.cpp -o base_functions.o\n";
         out3 << "main.o: $(RCLOBJECTS)\n";
-        out3 << "	g++ -m64 -Wall -fPIC -c main.c -o main.o\n";
+        out3 << "	g++ -m64 -O2 -Wall -fPIC -c main.c -o main.o\n";
         out3 << "clean:\n";
         out3 << "	rm -f *.o\n";
         out3 << "	rm -f "+lib_file+"\n";
@@ -397,10 +482,29 @@ bool SndController::parseFunctions()
     return all_functions_loaded;
 }
 
+bool SndController::bindSounds()
+{
+    GenSoundInitFunction init_fct = (GenSoundInitFunction)(lib.resolve("sound_init"));
+    if (!init_fct) return false;
+
+    QVector<GenSoundDescriptor> descriptors;
+    baseSoundList->getDescriptors(&descriptors);
+    init_fct(base_play_sound, descriptors.constData(), descriptors.size());
+    return true;
+}
+
 double SndController::getResult(unsigned int channel, double current_t)
 {
     GenSoundChannelInfo *info = channels.at(channel);
-    return info->amp * info->channel_fct(current_t, info->k, info->freq, base_play_sound);
+    return info->amp * info->channel_fct(current_t, info->k, info->freq);
+}
+
+void SndController::renderChannel(unsigned int channel, float *block, unsigned int count)
+{
+    for (unsigned int i=0; i<count; i++)
+    {
+        block[i] = output_gain * getResult(channel, t+i/frequency);
+    }
 }
 
 void SndController::resetParams()
@@ -414,7 +518,7 @@ void SndController::resetParams()
         info->fr = 0;
         info->function_text = "sin(k*t)";
     }
-    t = 0.0;
+    setFramePosition(0);
     t_real = 0.0;
 }
 
@@ -423,6 +527,16 @@ SoundList *SndController::getBaseSoundList() const
     return baseSoundList;
 }
 
+SndRingBuffer *SndController::getTap() const
+{
+    return tap;
+}
+
+SndLevelMeter *SndController::getLevelMeter() const
+{
+    return meter;
+}
+
 double SndController::getFrequency() const
 {
     return frequency;
@@ -514,15 +628,23 @@ void SndController::export_cycle(FMOD::Sound *sound)
         unsigned int datalength = 0;
         writeWavHeader(mainfile, sound, datalength);
 
-        unsigned int sec_buff_size = ((unsigned int) frequency) * channels_count * sizeof(qint32);
-        quint8 *buf = new quint8[sec_buff_size];
-        t = 0.0;
-        for(int second = 0; second<export_max_t; second++) {
-            fillBuffer(0, buf, sec_buff_size);
-            datalength += fwrite(buf, 1, sec_buff_size, mainfile);
-            emit export_status(round(100.0*second/export_max_t));
+        unsigned int block_frames = (unsigned int) frequency;
+        unsigned int frame_size = channels_count * sizeof(qint32);
+        quint8 *buf = new quint8[block_frames * frame_size];
+        int status_from = 0;
+        if (export_normalize != SndNormalizeNone) {
+            analyze_export();
+            status_from = 50;
         }
-        delete buf;
+        setFramePosition(export_from_frame);
+        for(quint64 done = 0; done<export_frames; ) {
+            unsigned int count = (unsigned int) qMin((quint64) block_frames, export_frames-done);
+            fillBuffer(0, buf, count*frame_size);
+            datalength += fwrite(buf, 1, count*frame_size, mainfile);
+            done += count;
+            emit export_status(status_from + round((100.0-status_from)*done/export_frames));
+        }
+        delete[] buf;
 
         if (datalength) {
             writeWavHeader(mainfile, sound, datalength);
@@ -531,16 +653,108 @@ void SndController::export_cycle(FMOD::Sound *sound)
         fclose(mainfile);
         qDebug() << tr("Sound object written to file");
 
+        writeExportReport();
+
         emit export_status(100);
     } else {
         emit write_message(tr("Error write to file: %filename%").replace("%filename%",export_filename));
     }
 }
 
+/*
+    Channel functions depend on t only, so the export is rendered twice: the first pass
+    measures true-peak and integrated loudness, the second one is written with the gain
+    that brings them to the target. Loudness targets are also limited to -1 dBTP.
+*/
+void SndController::analyze_export()
+{
+    emit write_message(tr("Analyzing..."));
+
+    unsigned int block_frames = (unsigned int) frequency;
+    if (tap_block.size()<block_frames) tap_block.resize(block_frames);
+    float *block = tap_block.data();
+
+    SndLoudness loudness;
+    loudness.setFormat(channels_count, frequency);
+    output_gain = 1;
+    setFramePosition(export_from_frame);
+    for(quint64 done = 0; done<export_frames; ) {
+        unsigned int count = (unsigned int) qMin((quint64) block_frames, export_frames-done);
+        for(unsigned int i=0; i<channels_count; i++) {
+            renderChannel(i, block, count);
+            loudness.process(i, block, count);
+        }
+        loudness.commit(count);
+        setFramePosition(frame_position + count);
+        done += count;
+        emit export_status(round(50.0*done/export_frames));
+    }
+
+    export_source_true_peak = SndLoudness::toDb(loudness.getTruePeak());
+    export_source_loudness = loudness.getIntegratedLoudness();
+
+    double gain_db = 0;
+    switch (export_normalize) {
+        case SndNormalizePeak:
+            if (loudness.getTruePeak()>0) gain_db = export_normalize_target - export_source_true_peak;
+        break;
+        case SndNormalizeLoudness:
+            if (loudness.isValid() && export_source_loudness>-HUGE_VAL) {
+                gain_db = export_normalize_target - export_source_loudness;
+                if (loudness.getTruePeak()>0) {
+                    gain_db = qMin(gain_db, loudness_true_peak_limit - export_source_true_peak);
+                }
+            }
+        break;
+        default:
+        break;
+    }
+    output_gain = SndLoudness::fromDb(gain_db);
+
+    emit write_message(tr("Export gain: %gain% dB").replace("%gain%", QString::number(gain_db, 'f', 2)));
+}
+
+/*
+    Measures the exported file and stores the figures next to it,
+    e.g. "tone.wav" -> "tone.report.ini".
+*/
+void SndController::writeExportReport()
+{
+    SndWavFile wav;
+    if (!wav.open(export_filename)) {
+        emit write_message(tr("Can't measure exported file: %error%").replace("%error%", wav.getError()));
+        return;
+    }
+
+    QSettings report(SndMeasurement::getReportFilename(export_filename), QSettings::IniFormat);
+    report.clear();
+    report.setValue("export/file", QFileInfo(export_filename).fileName());
+    report.setValue("export/frequency", wav.getFrequency());
+    report.setValue("export/channels", wav.getChannelsCount());
+    report.setValue("export/frames", wav.getFramesCount());
+    report.setValue("export/start_frame", export_from_frame);
+    report.setValue("export/start_seconds", export_from_frame/frequency);
+    report.setValue("export/clip_mode", SndPcmConverter::clipModeName(clip_mode));
+    if (export_normalize != SndNormalizeNone) {
+        report.setValue("export/normalize", export_normalize==SndNormalizePeak ? "peak" : "loudness");
+        report.setValue("export/normalize_target", export_normalize_target);
+        report.setValue("export/gain_db", SndLoudness::toDb(output_gain));
+        report.setValue("export/source_true_peak_dbtp", export_source_true_peak);
+        report.setValue("export/source_loudness_lufs", export_source_loudness);
+    }
+
+    SndMeasurement measurement;
+    for(unsigned int i=0; i<wav.getChannelsCount(); i++) {
+        SndMeasurement::writeReport(&report, "channel_"+QString::number(i), measurement.measureFile(&wav, i));
+        report.setValue("channel_"+QString::number(i)+"/clipped_samples", getClippedSamples(i));
+    }
+}
+
 void SndController::play_cycle(FMOD::Sound *sound)
 {
     FMOD::Channel          *channel = 0;
     unsigned int i;
+    SndToneResult tone;
 
     /*
         Play the sound.
@@ -591,14 +805,32 @@ void SndController::play_cycle(FMOD::Sound *sound)
             }
         }
 
+        /* full spectrum only for channels the tone trackers can't follow */
         for(i=0; i<channels.size(); i++) {
-            analyzer->function_fft_top_only(getChannelFunction(i), base_play_sound, t - 0.5, t + 0.5, channels.at(i)->freq, 1*frequency);
-            channels.at(i)->fr = analyzer->getInstFrequency();
-            channels.at(i)->ar = channels.at(i)->amp * analyzer->getInstAmp();
+            if (!trackers.at(i)->getResult(&tone)) continue;
+            if (tone.locked) {
+                channels.at(i)->fr = tone.freq;
+                channels.at(i)->ar = tone.peak;
+                continue;
+            }
+            if (tap->readLatest(i, analysis_block.data(), analysis_block.size())) {
+                analyzer->samples_fft_top_only(analysis_block.constData(), analysis_block.size(), frequency);
+                channels.at(i)->fr = analyzer->getInstFrequency();
+                channels.at(i)->ar = analyzer->getInstAmp();
+            }
         }
 
         QTimer::singleShot(1000, loop, SLOT(quit()));
         loop->exec();
+
+        /* rewinding flushes the buffered second, pcmsetposcallback applies the seek */
+        if (channel && seek_pending.fetchAndStoreOrdered(0)) {
+            seek_frame = (quint64) round(seek_seconds*frequency);
+            t_real = seek_frame/frequency;
+            t_real_ms_unixtime = QDateTime::currentMSecsSinceEpoch();
+            seek_apply.storeRelease(1);
+            channel->setPosition(0, FMOD_TIMEUNIT_PCM);
+        }
     } while (!is_stopping);
     timer->stop();
 
@@ -615,7 +847,14 @@ void SndController::process_sound()
     GenSoundChannelInfo    *info;
     bool parsed;
 
-    t = t_real = 0.0;
+    quint64 start_frame = 0;
+    if (process_mode == SndPlay && seek_pending.fetchAndStoreOrdered(0)) {
+        start_frame = (quint64) round(seek_seconds*frequency);
+    }
+    seek_apply.storeRelease(0);
+    setFramePosition(start_frame);
+    t_real = t;
+    output_gain = 1;
     is_stopping = false;
     emit write_message(tr("Initialization..."));
 
@@ -630,7 +869,7 @@ void SndController::process_sound()
     sound_functions = baseSoundList->getFunctionsText();
     console << tr("Sounds:") << "[" << sound_functions << "]" << endl;
 
-    parsed = parseFunctions();
+    parsed = parseFunctions() && bindSounds();
 
     if (!parsed) {
         emit write_message(tr("Error in functions!"));
@@ -638,6 +877,21 @@ void SndController::process_sound()
         return;
     }
 
+    /*
+        Rendered samples are published to the tap so analysis and visualizers
+        don't need to evaluate channel functions again.
+    */
+    tap->setFormat(channels_count, tap_seconds*((unsigned int) frequency));
+    meter->setFormat(channels_count, ((unsigned int) frequency)/meter_blocks_per_second, tap_seconds*meter_blocks_per_second);
+    tap->reset((quint32) start_frame);
+    meter->reset((quint32) start_frame);
+    tap_block.resize(createsoundexinfo_gen.decodebuffersize);
+    analysis_block.resize((unsigned int) (analysis_seconds*frequency));
+    for(unsigned int i=0; i<channels_count; i++) {
+        trackers.at(i)->setFormat(frequency, tracker_block);
+    }
+    clipped_samples.fill(0, channels_count);
+
     if (process_mode == SndPlay) emit started();
 
     mode |= FMOD_CREATESTREAM;
@@ -699,10 +953,14 @@ void SndController::stop() {
     emit stopped();
 }
 
-void SndController::run_export(int seconds, QString filename) {
+void SndController::run_export(double from, double to, QString filename, SndNormalizeMode normalize, double normalize_target) {
     process_mode = SndExport;
-    export_max_t = seconds;
+    export_from_frame = (quint64) round(qMax(0.0, from)*frequency);
+    export_frames = (quint64) round(qMax(0.0, to)*frequency);
+    export_frames = export_frames>export_from_frame ? export_frames-export_from_frame : 0;
     export_filename = filename;
+    export_normalize = normalize;
+    export_normalize_target = normalize_target;
     process_thread->start();
     while (process_thread->isFinished()) {}
 }
@@ -737,6 +995,22 @@ double SndController::getInstAmp(unsigned int channel)
     return channels.at(channel)->ar;
 }
 
+unsigned int SndController::getClippedSamples(unsigned int channel) const
+{
+    if (channel>=(unsigned int) clipped_samples.size()) return 0;
+    return clipped_samples.at(channel);
+}
+
+SndClipMode SndController::getClipMode() const
+{
+    return clip_mode;
+}
+
+void SndController::setClipMode(SndClipMode value)
+{
+    clip_mode = value;
+}
+
 double SndController::getT()
 {
     double rt;
@@ -15,6 +15,12 @@
 #include "soundlist.h"
 #include "classes/environmentinfo.h"
 #include "classes/sndanalyzer.h"
+#include "classes/sndringbuffer.h"
+#include "classes/sndlevelmeter.h"
+#include "classes/sndpcmconverter.h"
+#include "classes/sndloudness.h"
+#include "classes/sndtonetracker.h"
+#include "classes/sndmeasurement.h"
 
 #if defined(WIN32) || defined(__WATCOMC__) || defined(_WIN32) || defined(__WIN32__)
     #define __PACKED                         /* dummy */
@@ -25,6 +31,7 @@
 double base_play_sound(int i, unsigned int c, double t);
 
 enum SndControllerPlayMode { SndPlay, SndExport };
+enum SndNormalizeMode { SndNormalizeNone, SndNormalizePeak, SndNormalizeLoudness };
 
 class SndController : public QObject, public AbstractSndController
 {
@@ -36,26 +43,49 @@ private:
 
     Q_DISABLE_COPY(SndController);
 
+    static const unsigned int tap_seconds = 8;
+    static const double analysis_seconds;
+    static const unsigned int tracker_block = 1024;
+    static const unsigned int tracker_harmonics = 4;
+    static const unsigned int meter_blocks_per_second = 100;
+    static const double loudness_true_peak_limit;
+
     QString getCurrentParseHash();
     bool checkHash(bool emptyCheck);
     bool parseFunctions();
+    bool bindSounds();
     double getResult(unsigned int channel, double current_t);
+    void renderChannel(unsigned int channel, float *block, unsigned int count);
 
     void resetParams();
+    void setFramePosition(quint64 frame);
     void play_cycle(FMOD::Sound *sound);
     void export_cycle(FMOD::Sound *sound);
+    void analyze_export();
     void writeWavHeader(FILE *file, FMOD::Sound *sound, int length);
+    void writeExportReport();
 
     bool is_stopping, is_running;
     double t, t_real;
+    quint64 frame_position;
+    QAtomicInt seek_pending, seek_apply;
+    double seek_seconds;
+    quint64 seek_frame;
     qint64 t_real_ms_unixtime;
     bool all_functions_loaded;
     unsigned int channels_count;
     double frequency;
-    int export_max_t;
+    double output_gain;
+    quint64 export_from_frame, export_frames;
     QString export_filename;
+    SndNormalizeMode export_normalize;
+    double export_normalize_target;
+    double export_source_loudness, export_source_true_peak;
 
     QVector<GenSoundChannelInfo*> channels;
+    QVector<SndToneTracker*> trackers;
+    QVector<unsigned int> clipped_samples;
+    SndClipMode clip_mode;
 
     SoundList *baseSoundList;
     QString text_functions, sound_functions;
@@ -70,11 +100,16 @@ private:
     FMOD_RESULT result;
     SndControllerPlayMode process_mode;
     SndAnalyzer *analyzer;
+    SndRingBuffer *tap;
+    SndLevelMeter *meter;
+    QVector<float> tap_block;
+    QVector<float> analysis_block;
 public:
     static SndController* Instance();
     static bool DeleteInstance();
 
     void fillBuffer(FMOD_SOUND *sound, void *data, unsigned int datalen);
+    void applySeek();
     double playSound(int index, unsigned int channel, double t);
 
     void setChannelsCount(unsigned int count);
@@ -90,16 +125,23 @@ public:
 
     double getInstFreq(unsigned int channel);
     double getInstAmp(unsigned int channel);
+    unsigned int getClippedSamples(unsigned int channel) const;
+
+    SndClipMode getClipMode() const;
+    void setClipMode(SndClipMode value);
     double getT();
     GenSoundFunction getChannelFunction(unsigned int channel);
 
     FMOD::System *getFmodSystem();
     FMOD_CREATESOUNDEXINFO getFmodSoundCreateInfo();
     SoundList *getBaseSoundList() const;
+    SndRingBuffer *getTap() const;
+    SndLevelMeter *getLevelMeter() const;
     bool running();
     void run();
     void stop();
-    void run_export(int seconds, QString filename);
+    void seek(double seconds);
+    void run_export(double from, double to, QString filename, SndNormalizeMode normalize = SndNormalizeNone, double normalize_target = 0);
     void stop_export();
 signals:
     void starting();
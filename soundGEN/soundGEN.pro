@@ -59,18 +59,34 @@ android {
 SOURCES += main.cpp\
     base_functions.cpp \
     classes/environmentinfo.cpp \
+    classes/samplecache.cpp \
     abstractsndcontroller.cpp \
     kiss_fft/kiss_fft.c \
     kiss_fft/kiss_fftr.c \
     classes/sndanalyzer.cpp \
+    classes/sndbluestein.cpp \
+    classes/sndringbuffer.cpp \
+    classes/sndlevelmeter.cpp \
+    classes/sndpcmconverter.cpp \
+    classes/sndloudness.cpp \
+    classes/sndstft.cpp \
+    classes/sndtonetracker.cpp \
+    classes/sndwavfile.cpp \
+    classes/sndmeasurement.cpp \
+    classes/sndbatchanalyzer.cpp \
     mainwindow.cpp \
     sndcontroller.cpp \
     widgets/soundpicker.cpp \
     soundlist.cpp \
     widgets/functiongraphicdrawer.cpp \
-    classes/graphicthread.cpp \
+    classes/framescheduler.cpp \
+    classes/fftthread.cpp \
+    classes/waveformthread.cpp \
     widgets/mgraphicdrawsurface.cpp \
     widgets/mfftdrawsurface.cpp \
+    widgets/mspectrogramdrawsurface.cpp \
+    widgets/mscopedrawsurface.cpp \
+    widgets/mlevelmeter.cpp \
     widgets/channelsettings.cpp \
     classes/highlighter.cpp \
     classes/utextblockdata.cpp \
@@ -80,6 +96,7 @@ SOURCES += main.cpp\
 
 HEADERS  += base_functions.h \
     classes/environmentinfo.h \
+    classes/samplecache.h \
     abstractsndcontroller.h \
     widgets/soundpicker.h \
     soundlist.h \
@@ -89,11 +106,26 @@ HEADERS  += base_functions.h \
     kiss_fft/kissfft.hh \
     kiss_fft/kiss_fftr.h \
     classes/sndanalyzer.h \
+    classes/sndbluestein.h \
+    classes/sndringbuffer.h \
+    classes/sndlevelmeter.h \
+    classes/sndpcmconverter.h \
+    classes/sndloudness.h \
+    classes/sndstft.h \
+    classes/sndtonetracker.h \
+    classes/sndwavfile.h \
+    classes/sndmeasurement.h \
+    classes/sndbatchanalyzer.h \
     mainwindow.h \
     widgets/functiongraphicdrawer.h \
-    classes/graphicthread.h \
+    classes/framescheduler.h \
+    classes/fftthread.h \
+    classes/waveformthread.h \
     widgets/mgraphicdrawsurface.h \
     widgets/mfftdrawsurface.h \
+    widgets/mspectrogramdrawsurface.h \
+    widgets/mscopedrawsurface.h \
+    widgets/mlevelmeter.h \
     widgets/channelsettings.h \
     classes/highlighter.h \
     classes/utextblockdata.h \
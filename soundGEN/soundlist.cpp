@@ -19,7 +19,9 @@ void SoundList::removeSound(int i, bool removeFromList)
         result = rec->base_sound->release();
         AbstractSndController::ERRCHECK(result);
     }
-    if (rec->pcmData) {
+    if (rec->cache_file) {
+        SampleCache::release(rec->cache_file);
+    } else if (rec->pcmData) {
         delete[] rec->pcmData;
     }
     delete rec;
@@ -48,6 +50,7 @@ void SoundList::setSound(int index, QString new_file, QString new_function, unsi
         GenSoundRecord *rec = new GenSoundRecord;
         rec->base_sound = 0;
         rec->pcmData = 0;
+        rec->cache_file = 0;
         rec->soundLenPcmBytes = 0;
         rec->soundLen = 0;
         rec->sound_function = new_function;
@@ -120,7 +123,18 @@ void SoundList::InitSounds()
     {
         if (!rec->sound_file.isEmpty() && !rec->sound_function.isEmpty())
         {
-            if (!rec->base_sound)
+            QString cache_key;
+
+            if (!rec->pcmData)
+            {
+                cache_key = SampleCache::getKey(rec->sound_file);
+                rec->cache_file = SampleCache::load(cache_key, &(rec->pcmData), &(rec->soundLen), &(rec->channels_count), &(rec->frequency));
+                if (rec->cache_file) {
+                    rec->soundLenPcmBytes = rec->soundLen*sizeof(qint32);
+                }
+            }
+
+            if (!rec->base_sound && !rec->pcmData)
             {
                 result = sc->getFmodSystem()->createSound(qPrintable(rec->sound_file), FMOD_OPENONLY | FMOD_ACCURATETIME, 0, &(rec->base_sound));
                 AbstractSndController::ERRCHECK(result);
@@ -157,6 +171,7 @@ void SoundList::InitSounds()
                         rec->pcmData = (qint32*) pcmData;
                         rec->frequency = freq;
                         rec->channels_count = channels_count;
+                        SampleCache::store(cache_key, rec->pcmData, rec->soundLen, rec->channels_count, rec->frequency);
                     }
                 }
                 delete[] soundbuf;
@@ -175,9 +190,93 @@ void SoundList::setTag(unsigned int newtag)
     curr_tag = newtag;
 }
 
+QString SoundList::getHeaderText()
+{
+    QString result = "";
+
+    /*
+        Sample access helpers for generated code.
+        __sound_play keeps a read cursor per sound and channel function:
+        sequential calls advance it incrementally, any other access pattern
+        recomputes the position from t, so results don't depend on call order.
+        Cursors are thread local, the audio thread and the graphic workers
+        evaluate the same channel functions at the same time.
+    */
+    result += "#if defined(_MSC_VER)\n";
+    result += "#define __SOUND_THREAD_LOCAL __declspec(thread)\n";
+    result += "#else\n";
+    result += "#define __SOUND_THREAD_LOCAL __thread\n";
+    result += "#endif\n";
+    result += "struct SoundDescriptor { const int *data; unsigned int length; double frequency; unsigned int channels_count; };\n";
+    result += "struct SoundCursor { double t; double pos; double offset; double rate; double loop_start; double loop_end; double xfade; };\n";
+    result += "static inline double __sound_value(const SoundDescriptor *s, unsigned int c, unsigned int frame) {\n";
+    result += "    unsigned int offset = frame*s->channels_count;\n";
+    result += "    if (c==0) {\n";
+    result += "        double r = 0;\n";
+    result += "        for(unsigned int i=0;i<s->channels_count;i++) r+=s->data[offset+i];\n";
+    result += "        return r*(1.0/2147483647.0)/s->channels_count;\n";
+    result += "    }\n";
+    result += "    return c<=s->channels_count ? s->data[offset+c-1]*(1.0/2147483647.0) : 0;\n";
+    result += "}\n";
+    result += "static inline double __sound_sample(const SoundDescriptor *s, unsigned int c, double t) {\n";
+    result += "    double pos = t*s->frequency;\n";
+    result += "    if (!s->data || pos<0 || pos>=s->length) return 0;\n";
+    result += "    unsigned int frame = (unsigned int) pos;\n";
+    result += "    if ((frame+1)*s->channels_count>s->length) return 0;\n";
+    result += "    return __sound_value(s, c, frame);\n";
+    result += "}\n";
+    result += "static inline double __sound_frame(const SoundDescriptor *s, unsigned int c, double pos) {\n";
+    result += "    unsigned int frames = s->length/s->channels_count;\n";
+    result += "    if (pos<0 || pos>=frames) return 0;\n";
+    result += "    unsigned int frame = (unsigned int) pos;\n";
+    result += "    double a = __sound_value(s, c, frame);\n";
+    result += "    double b = frame+1<frames ? __sound_value(s, c, frame+1) : 0;\n";
+    result += "    return a+(pos-frame)*(b-a);\n";
+    result += "}\n";
+    result += "static inline double __sound_length(const SoundDescriptor *s) {\n";
+    result += "    return s->data ? s->length/s->channels_count/s->frequency : 0;\n";
+    result += "}\n";
+    result += "static inline double __sound_play(const SoundDescriptor *s, SoundCursor *cur, unsigned int c, double t, double offset, double rate, double loop_start, double loop_end, double xfade) {\n";
+    result += "    if (!s->data || t<0 || rate<=0) return 0;\n";
+    result += "    double start = loop_start*s->frequency;\n";
+    result += "    double end = loop_end*s->frequency;\n";
+    result += "    if (end>s->length/s->channels_count) end = s->length/s->channels_count;\n";
+    result += "    double len = end-start;\n";
+    result += "    bool looped = start>=0 && len>0;\n";
+    result += "    double fade = looped && xfade>0 ? xfade*s->frequency : 0;\n";
+    result += "    if (fade>len/2) fade = len/2;\n";
+    result += "    double period = len-fade;\n";
+    result += "    double dt = t-cur->t;\n";
+    result += "    double pos;\n";
+    result += "    if (dt>=0 && dt<0.1 && cur->rate==rate && cur->offset==offset && cur->loop_start==loop_start && cur->loop_end==loop_end && cur->xfade==xfade) {\n";
+    result += "        pos = cur->pos+dt*rate*s->frequency;\n";
+    result += "        if (looped) while (pos>=end) pos-=period;\n";
+    result += "    } else {\n";
+    result += "        pos = (offset+t*rate)*s->frequency;\n";
+    result += "        if (looped && pos>=end) pos = end-period+fmod(pos-end, period);\n";
+    result += "        cur->offset = offset;\n";
+    result += "        cur->rate = rate;\n";
+    result += "        cur->loop_start = loop_start;\n";
+    result += "        cur->loop_end = loop_end;\n";
+    result += "        cur->xfade = xfade;\n";
+    result += "    }\n";
+    result += "    cur->t = t;\n";
+    result += "    cur->pos = pos;\n";
+    result += "    double r = __sound_frame(s, c, pos);\n";
+    result += "    if (fade>0 && pos>end-fade) {\n";
+    result += "        double w = (pos-end+fade)/fade;\n";
+    result += "        r = (1-w)*r+w*__sound_frame(s, c, pos-period);\n";
+    result += "    }\n";
+    result += "    return r;\n";
+    result += "}\n";
+
+    return result;
+}
+
 QString SoundList::getFunctionsText()
 {
     QString result = "";
+    QString sound;
     GenSoundRecord *rec;
     int i = 0, j;
 
@@ -187,20 +286,47 @@ QString SoundList::getFunctionsText()
         if (rec->pcmData)
         {
             i = baseSoundsList.indexOf(rec);
-            result += "double " + rec->sound_function + "(double t) { return BaseSoundFunction("+QString::number(i)+", 0, t);} \n";
+            result += "inline double " + rec->sound_function + "(double t) { return __sound_sample(&__sound_descriptors["+QString::number(i)+"], 0, t);} \n";
             if (rec->channels_count>=2) {
-                result += "double " + rec->sound_function + "_L(double t) { return BaseSoundFunction("+QString::number(i)+", 1, t);} \n";
-                result += "double " + rec->sound_function + "_R(double t) { return BaseSoundFunction("+QString::number(i)+", 2, t);} \n";
+                result += "inline double " + rec->sound_function + "_L(double t) { return __sound_sample(&__sound_descriptors["+QString::number(i)+"], 1, t);} \n";
+                result += "inline double " + rec->sound_function + "_R(double t) { return __sound_sample(&__sound_descriptors["+QString::number(i)+"], 2, t);} \n";
             }
             for(j=0;j<rec->channels_count;j++) {
-                result += "double " + rec->sound_function + "_" + QString::number(j)+"(double t) { return BaseSoundFunction("+QString::number(i)+", "+QString::number(j+1)+", t);} \n";
+                result += "inline double " + rec->sound_function + "_" + QString::number(j)+"(double t) { return __sound_sample(&__sound_descriptors["+QString::number(i)+"], "+QString::number(j+1)+", t);} \n";
             }
+            sound = "&__sound_descriptors["+QString::number(i)+"], &__sound_cursors[__SOUND_CHANNEL]["+QString::number(i)+"]";
+            result += "#define " + rec->sound_function + "_play(t, offset, rate) __sound_play("+sound+", 0, t, offset, rate, 0, 0, 0)\n";
+            result += "#define " + rec->sound_function + "_loop(t, loop_start, loop_end) __sound_play("+sound+", 0, t, 0, 1, loop_start, loop_end, 0)\n";
+            result += "#define " + rec->sound_function + "_xloop(t, loop_start, loop_end, xfade) __sound_play("+sound+", 0, t, 0, 1, loop_start, loop_end, xfade)\n";
+            result += "#define " + rec->sound_function + "_ex(t, channel, offset, rate, loop_start, loop_end, xfade) __sound_play("+sound+", channel, t, offset, rate, loop_start, loop_end, xfade)\n";
+            result += "#define " + rec->sound_function + "_len __sound_length(&__sound_descriptors["+QString::number(i)+"])\n";
         }
     }
 
     return result;
 }
 
+int SoundList::getSoundsCount()
+{
+    return baseSoundsList.size();
+}
+
+void SoundList::getDescriptors(QVector<GenSoundDescriptor> *descriptors)
+{
+    GenSoundRecord *rec;
+    GenSoundDescriptor descriptor;
+
+    descriptors->clear();
+    foreach(rec, baseSoundsList)
+    {
+        descriptor.data = rec->pcmData;
+        descriptor.length = rec->pcmData ? rec->soundLen : 0;
+        descriptor.frequency = rec->frequency;
+        descriptor.channels_count = rec->channels_count;
+        descriptors->append(descriptor);
+    }
+}
+
 double SoundList::playSound(int index, unsigned int channel, double t)
 {
     double result = 0;
@@ -209,7 +335,7 @@ double SoundList::playSound(int index, unsigned int channel, double t)
     if (baseSoundsList.size()>index) {
         GenSoundRecord *rec = baseSoundsList.data()[index];
 
-        if (rec->base_sound && rec->pcmData && rec->soundLen)
+        if (rec->pcmData && rec->soundLen)
         {
             unsigned int offset = ((unsigned int) (t*rec->frequency))*rec->channels_count;
             if (offset+rec->channels_count-1<rec->soundLen) {
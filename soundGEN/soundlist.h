@@ -12,6 +12,7 @@
 #include <fmod.hpp>
 #include <fmod_errors.h>
 #include "abstractsndcontroller.h"
+#include "classes/samplecache.h"
 
 struct GenSoundRecord {
     QString sound_file;
@@ -22,6 +23,7 @@ struct GenSoundRecord {
     unsigned int channels_count;
     double frequency;
     qint32 *pcmData;
+    QFile *cache_file;
     unsigned int tag;
 };
 
@@ -38,7 +40,10 @@ public:
     SoundList(AbstractSndController* base_controller);
     ~SoundList();
     void setSound(int index, QString new_file, QString new_function, unsigned int tag = 0);
+    QString getHeaderText();
     QString getFunctionsText();
+    int getSoundsCount();
+    void getDescriptors(QVector<GenSoundDescriptor> *descriptors);
     double playSound(int index, unsigned int channel, double t);
     void InitSounds();
     unsigned int getTag();
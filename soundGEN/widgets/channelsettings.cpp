@@ -14,7 +14,10 @@ ChannelSettings::ChannelSettings(QWidget *parent, unsigned int base_channel_inde
     function_edit->document()->setPlainText("sin(k*t)");
     ui->function_layout->insertWidget(1, function_edit);
     channel_drawer = new functionGraphicDrawer();
+    channel_drawer->setChannel(channel_index);
     ui->settings_base_horizontal_layout->addWidget(channel_drawer);
+    level_meter = new MLevelMeter(channel_index);
+    ui->settings_base_horizontal_layout->addWidget(level_meter);
 
     #if defined(__ANDROID__)
     QPalette Pal = function_edit->palette();
@@ -27,6 +30,7 @@ ChannelSettings::ChannelSettings(QWidget *parent, unsigned int base_channel_inde
     setChannelsCount(channels_count);
 
     QObject::connect(sc, SIGNAL(cycle_start()), this, SLOT(cycle_starting()));
+    QObject::connect(sc, SIGNAL(started()), level_meter, SLOT(start()));
 
     QObject::connect(dialog_functions, SIGNAL(accepted()), this, SLOT(paste_function_accepted()));
 
@@ -53,6 +57,7 @@ ChannelSettings::~ChannelSettings()
 {
     channel_drawer->deleteLater();
     delete channel_drawer;
+    delete level_meter;
     delete function_edit;
     delete dialog_functions;
     delete ui;
@@ -5,6 +5,7 @@
 #include "../classes/utextedit.h"
 #include "dialogfunctions.h"
 #include "functiongraphicdrawer.h"
+#include "mlevelmeter.h"
 
 namespace Ui {
 class ChannelSettings;
@@ -53,6 +54,7 @@ private:
     SndController *sc;
     unsigned int channel_index;
     functionGraphicDrawer *channel_drawer;
+    MLevelMeter *level_meter;
 };
 
 #endif // CHANNELSETTINGS_H
@@ -20,16 +20,16 @@ void DialogExport::on_buttonBox_clicked(QAbstractButton *button)
 {
     if (button == ui->buttonBox->button(QDialogButtonBox::Save))
     {
-        QTime tedit = ui->timeEdit->time();
-        int seconds = tedit.second() + tedit.minute()*60 + tedit.hour()*3600;
-        if (seconds>0) {
+        double from = ui->doubleSpinBox_from->value();
+        double to = ui->doubleSpinBox_to->value();
+        if ((to-from)*SndController::Instance()->getFrequency()>=1) {
             if (ui->filenameEdit->text().size()>0) {
-                exportProcess(seconds, ui->filenameEdit->text());
+                exportProcess(from, to, ui->filenameEdit->text());
             } else {
                 QMessageBox::critical(this, tr("Export"), tr("You need to set export file!"), QMessageBox::Ok, QMessageBox::Ok);
             }
         } else {
-            QMessageBox::critical(this, tr("Export"), tr("You need to set duration to at least 1 second!"), QMessageBox::Ok, QMessageBox::Ok);
+            QMessageBox::critical(this, tr("Export"), tr("You need to set the end at least one sample after the start!"), QMessageBox::Ok, QMessageBox::Ok);
         }
     } else {
         close();
@@ -43,14 +43,34 @@ void DialogExport::on_pushButton_filename_clicked()
     ui->filenameEdit->setText(fileName);
 }
 
-void DialogExport::exportProcess(int seconds, QString filename)
+void DialogExport::on_comboBox_normalize_currentIndexChanged(int index)
 {
-    ui->buttonBox->setEnabled(false);
-    ui->filenameEdit->setEnabled(false);
-    ui->timeEdit->setEnabled(false);
-    ui->label_filename->setEnabled(false);
-    ui->label_timeEdit->setEnabled(false);
-    SndController::Instance()->run_export(seconds, filename);
+    ui->doubleSpinBox_normalize_target->setEnabled(index != SndNormalizeNone);
+    if (index == SndNormalizeLoudness) {
+        ui->doubleSpinBox_normalize_target->setValue(-23);
+    } else {
+        ui->doubleSpinBox_normalize_target->setValue(-1);
+    }
+}
+
+void DialogExport::exportProcess(double from, double to, QString filename)
+{
+    setControlsEnabled(false);
+    SndController::Instance()->run_export(from, to, filename, (SndNormalizeMode) ui->comboBox_normalize->currentIndex(), ui->doubleSpinBox_normalize_target->value());
+}
+
+void DialogExport::setControlsEnabled(bool enabled)
+{
+    ui->buttonBox->setEnabled(enabled);
+    ui->filenameEdit->setEnabled(enabled);
+    ui->doubleSpinBox_from->setEnabled(enabled);
+    ui->doubleSpinBox_to->setEnabled(enabled);
+    ui->label_filename->setEnabled(enabled);
+    ui->label_from->setEnabled(enabled);
+    ui->label_to->setEnabled(enabled);
+    ui->label_normalize->setEnabled(enabled);
+    ui->comboBox_normalize->setEnabled(enabled);
+    ui->doubleSpinBox_normalize_target->setEnabled(enabled && ui->comboBox_normalize->currentIndex() != SndNormalizeNone);
 }
 
 void DialogExport::export_status_changed(int percent)
@@ -60,11 +80,7 @@ void DialogExport::export_status_changed(int percent)
 
 void DialogExport::export_finished()
 {
-    ui->buttonBox->setEnabled(true);
-    ui->filenameEdit->setEnabled(true);
-    ui->timeEdit->setEnabled(true);
-    ui->label_filename->setEnabled(true);
-    ui->label_timeEdit->setEnabled(true);
+    setControlsEnabled(true);
     QMessageBox::information(this, tr("Export"), tr("Export successfully finished!"), QMessageBox::Ok, QMessageBox::Ok);
     close();
 }
@@ -3,7 +3,6 @@
 
 #include <QDialog>
 #include <QAbstractButton>
-#include <QTimeEdit>
 #include <QTime>
 #include <QFileDialog>
 #include <QMessageBox>
@@ -27,6 +26,8 @@ private slots:
 
     void on_pushButton_filename_clicked();
 
+    void on_comboBox_normalize_currentIndexChanged(int index);
+
     void export_status_changed(int percent);
 
     void export_finished();
@@ -35,7 +36,8 @@ private slots:
 private:
     Ui::DialogExport *ui;
 
-    void exportProcess(int seconds, QString filename);
+    void exportProcess(double from, double to, QString filename);
+    void setControlsEnabled(bool enabled);
 };
 
 #endif // DIALOGEXPORT_H
@@ -1,14 +1,14 @@
 #include "functiongraphicdrawer.h"
 #include "ui_functiongraphicdrawer.h"
 
-graphicThread* functionGraphicDrawer::mThread = 0;
-
 functionGraphicDrawer::functionGraphicDrawer(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::functionGraphicDrawer)
 {
     ui->setupUi(this);
     block_change = false;
+    running = final_frame = false;
+    tap_position = 0;
 
     #if defined(__ANDROID__) || defined(ANDROID)
     ui->ampSlider->setOrientation(Qt::Horizontal);
@@ -27,12 +27,19 @@ functionGraphicDrawer::functionGraphicDrawer(QWidget *parent) :
     widget_fft_drawer->setHidden(true);
     widget_fft_drawer->setTimerInterval(30);
 
-    if (mThread==0) {
-        mThread = new graphicThread();
-        mThread->setInterval(30);
-    }
+    widget_spectrogram_drawer = new MSpectrogramDrawSurface();
+    widget_spectrogram_drawer->setSizePolicy(QSizePolicy::Expanding,QSizePolicy::Expanding);
+    ui->verticalLayout->addWidget(widget_spectrogram_drawer);
+    widget_spectrogram_drawer->setVisible(false);
+    widget_spectrogram_drawer->setHidden(true);
 
-    mThread->addGraphic(this);
+    widget_scope_drawer = new MScopeDrawSurface();
+    widget_scope_drawer->setSizePolicy(QSizePolicy::Expanding,QSizePolicy::Expanding);
+    ui->verticalLayout->addWidget(widget_scope_drawer);
+    widget_scope_drawer->setVisible(false);
+    widget_scope_drawer->setHidden(true);
+
+    FrameScheduler::Instance()->addClient(this);
 
     widget_drawer->setT(0.001);
     widget_drawer->setT0(0.001);
@@ -49,6 +56,11 @@ functionGraphicDrawer::functionGraphicDrawer(QWidget *parent) :
 
     ui->durationSlider_fft->setVisible(false);
     ui->widget_duration_fft->setVisible(false);
+    ui->comboBox_fft_average->setVisible(false);
+    ui->comboBox_fft_scale->setVisible(false);
+    ui->comboBox_trigger->setVisible(false);
+    ui->doubleSpinBox_trigger_level->setVisible(false);
+    ui->comboBox_trigger->setCurrentIndex(widget_scope_drawer->getTrigger());
 
     on_durationSlider_valueChanged(ui->durationSlider->value());
     on_ampSlider_valueChanged(ui->ampSlider->value());
@@ -56,15 +68,11 @@ functionGraphicDrawer::functionGraphicDrawer(QWidget *parent) :
 
 functionGraphicDrawer::~functionGraphicDrawer()
 {
-    mThread->removeGraphic();
-    if (mThread->getLinksCount()==0) {
-        mThread->Stop = true;
-        mThread->quit();
-        delete mThread;
-        mThread = 0;
-    }
+    FrameScheduler::Instance()->removeClient(this);
     delete widget_drawer;
     delete widget_fft_drawer;
+    delete widget_spectrogram_drawer;
+    delete widget_scope_drawer;
     delete ui;
 }
 
@@ -154,30 +162,151 @@ void functionGraphicDrawer::setFft(bool value)
     block_change = false;
 }
 
+int functionGraphicDrawer::getFftAverageMode() const
+{
+    return ui->comboBox_fft_average->currentIndex();
+}
+
+void functionGraphicDrawer::setFftAverageMode(int value)
+{
+    block_change = true;
+    ui->comboBox_fft_average->setCurrentIndex(value);
+    block_change = false;
+}
+
+int functionGraphicDrawer::getFftScale() const
+{
+    return ui->comboBox_fft_scale->currentIndex();
+}
+
+void functionGraphicDrawer::setFftScale(int value)
+{
+    block_change = true;
+    ui->comboBox_fft_scale->setCurrentIndex(value);
+    block_change = false;
+}
+
+bool functionGraphicDrawer::isSpectrogram()
+{
+    return ui->checkBox_spectrogram->isChecked();
+}
+
+void functionGraphicDrawer::setSpectrogram(bool value)
+{
+    block_change = true;
+    ui->checkBox_spectrogram->setChecked(value);
+    block_change = false;
+}
+
+bool functionGraphicDrawer::isScope()
+{
+    return ui->checkBox_scope->isChecked();
+}
+
+void functionGraphicDrawer::setScope(bool value)
+{
+    block_change = true;
+    ui->checkBox_scope->setChecked(value);
+    block_change = false;
+}
+
+int functionGraphicDrawer::getTrigger() const
+{
+    return ui->comboBox_trigger->currentIndex();
+}
+
+void functionGraphicDrawer::setTrigger(int value)
+{
+    block_change = true;
+    ui->comboBox_trigger->setCurrentIndex(value);
+    block_change = false;
+}
+
+double functionGraphicDrawer::getTriggerLevel() const
+{
+    return ui->doubleSpinBox_trigger_level->value();
+}
+
+void functionGraphicDrawer::setTriggerLevel(double value)
+{
+    block_change = true;
+    ui->doubleSpinBox_trigger_level->setValue(value);
+    block_change = false;
+}
+
+void functionGraphicDrawer::setChannel(unsigned int value)
+{
+    widget_fft_drawer->setChannel(value);
+    widget_spectrogram_drawer->setChannel(value);
+    widget_scope_drawer->setChannel(value);
+}
+
+bool functionGraphicDrawer::frameActive()
+{
+    return running || final_frame;
+}
+
+/* the graph and the spectrum move with the time, the scope and the spectrogram only show new samples */
+bool functionGraphicDrawer::frameNeeded()
+{
+    if (final_frame) return true;
+    if (!widget_drawer->isHidden() && widget_drawer->getKt()*widget_drawer->getDt()!=0) return true;
+    if (!widget_fft_drawer->isHidden()) return true;
+    return SndController::Instance()->getTap()->getWritePosition()!=tap_position;
+}
+
+bool functionGraphicDrawer::frameVisible()
+{
+    return isVisible() && !window()->isMinimized();
+}
+
+void functionGraphicDrawer::frameStep()
+{
+    final_frame = false;
+    drawCycle();
+}
+
 void functionGraphicDrawer::drawCycle()
 {
-    widget_drawer->incT();
-    widget_drawer->update();
-    ui->lcdNumber_t->display(widget_drawer->getT());
-    widget_fft_drawer->incT();
-    widget_fft_drawer->update();
+    tap_position = SndController::Instance()->getTap()->getWritePosition();
+    if (!widget_drawer->isHidden()) {
+        widget_drawer->incT();
+        widget_drawer->update();
+        ui->lcdNumber_t->display(widget_drawer->getT());
+    }
+    if (!widget_fft_drawer->isHidden()) {
+        widget_fft_drawer->incT();
+        widget_fft_drawer->update();
+    }
+    if (!widget_spectrogram_drawer->isHidden()) {
+        widget_spectrogram_drawer->incT();
+        widget_spectrogram_drawer->update();
+    }
+    if (!widget_scope_drawer->isHidden()) {
+        widget_scope_drawer->incT();
+        widget_scope_drawer->update();
+    }
 }
 
 void functionGraphicDrawer::run()
 {
     drawCycle();
-    mThread->Stop = false;
-    mThread->start();
+    running = true;
+    FrameScheduler::Instance()->requestFrame();
 }
 
 void functionGraphicDrawer::stop()
 {
-    mThread->Stop = true;
+    running = false;
+    /* hidden drawers have nothing to finish */
+    final_frame = frameVisible();
+    if (final_frame) FrameScheduler::Instance()->requestFrame();
 }
 
 void functionGraphicDrawer::on_durationSlider_valueChanged(int value)
 {
     widget_drawer->setDt(0.1 * value / ui->durationSlider->maximum());
+    widget_scope_drawer->setDt(widget_drawer->getDt());
     ui->lcdNumber_dur->display(widget_drawer->getDt());
     if (!block_change) {
         emit changed();
@@ -187,6 +316,7 @@ void functionGraphicDrawer::on_durationSlider_valueChanged(int value)
 void functionGraphicDrawer::on_ampSlider_valueChanged(int value)
 {
     widget_drawer->setKamp(1.0 + (double) 2*value / ui->ampSlider->maximum());
+    widget_scope_drawer->setKamp(widget_drawer->getKamp());
     ui->lcdNumber_koef->display(widget_drawer->getKamp());
     if (!block_change) {
         emit changed();
@@ -200,25 +330,57 @@ void functionGraphicDrawer::on_checkBox_grouped_stateChanged(int arg1)
     }
 }
 
-void functionGraphicDrawer::on_checkBox_fft_stateChanged(int arg1)
+void functionGraphicDrawer::updateMode()
 {
-    bool fft_mode = ui->checkBox_fft->isChecked();
-    ui->widget_t->setVisible(!fft_mode);
-    ui->widget_duration->setVisible(!fft_mode);
+    bool spectrogram_mode = ui->checkBox_spectrogram->isChecked();
+    bool fft_mode = ui->checkBox_fft->isChecked() && !spectrogram_mode;
+    bool graphic_mode = !fft_mode && !spectrogram_mode;
+    bool scope_mode = graphic_mode && ui->checkBox_scope->isChecked();
+    ui->widget_t->setVisible(graphic_mode && !scope_mode);
+    ui->widget_duration->setVisible(graphic_mode);
 
     #if !defined(__ANDROID__) && !defined(ANDROID)
-    ui->ampSlider->setVisible(!fft_mode);
-    ui->widget_koef->setVisible(!fft_mode);
+    ui->ampSlider->setVisible(graphic_mode);
+    ui->widget_koef->setVisible(graphic_mode);
     #endif
 
-    ui->durationSlider->setVisible(!fft_mode);
+    ui->durationSlider->setVisible(graphic_mode);
     ui->durationSlider_fft->setVisible(fft_mode);
     ui->widget_duration_fft->setVisible(fft_mode);
-
-    widget_drawer->setVisible(!fft_mode);
-    widget_drawer->setHidden(fft_mode);
+    ui->comboBox_fft_average->setVisible(fft_mode);
+    ui->comboBox_fft_scale->setVisible(fft_mode);
+    ui->comboBox_trigger->setVisible(scope_mode);
+    ui->doubleSpinBox_trigger_level->setVisible(scope_mode);
+
+    widget_drawer->setVisible(graphic_mode && !scope_mode);
+    widget_drawer->setHidden(!graphic_mode || scope_mode);
+    widget_scope_drawer->setVisible(scope_mode);
+    widget_scope_drawer->setHidden(!scope_mode);
     widget_fft_drawer->setVisible(fft_mode);
     widget_fft_drawer->setHidden(!fft_mode);
+    widget_spectrogram_drawer->setVisible(spectrogram_mode);
+    widget_spectrogram_drawer->setHidden(!spectrogram_mode);
+
+    if (running) FrameScheduler::Instance()->requestFrame();
+}
+
+void functionGraphicDrawer::on_checkBox_fft_stateChanged(int arg1)
+{
+    if (ui->checkBox_fft->isChecked() && ui->checkBox_spectrogram->isChecked()) {
+        ui->checkBox_spectrogram->setChecked(false);
+    }
+    updateMode();
+    if (!block_change) {
+        emit changed();
+    }
+}
+
+void functionGraphicDrawer::on_checkBox_spectrogram_stateChanged(int arg1)
+{
+    if (ui->checkBox_spectrogram->isChecked() && ui->checkBox_fft->isChecked()) {
+        ui->checkBox_fft->setChecked(false);
+    }
+    updateMode();
     if (!block_change) {
         emit changed();
     }
@@ -232,3 +394,43 @@ void functionGraphicDrawer::on_durationSlider_fft_valueChanged(int value)
         emit changed();
     }
 }
+
+void functionGraphicDrawer::on_comboBox_fft_average_currentIndexChanged(int index)
+{
+    widget_fft_drawer->setAverageMode((MFftAverageMode) qBound(0, index, (int) FftAveragePeakHold));
+    if (!block_change) {
+        emit changed();
+    }
+}
+
+void functionGraphicDrawer::on_comboBox_fft_scale_currentIndexChanged(int index)
+{
+    widget_fft_drawer->setScale((MFftScale) qBound(0, index, (int) FftScaleConstantQ));
+    if (!block_change) {
+        emit changed();
+    }
+}
+
+void functionGraphicDrawer::on_checkBox_scope_stateChanged(int arg1)
+{
+    updateMode();
+    if (!block_change) {
+        emit changed();
+    }
+}
+
+void functionGraphicDrawer::on_comboBox_trigger_currentIndexChanged(int index)
+{
+    widget_scope_drawer->setTrigger((MScopeTrigger) qBound(0, index, (int) ScopeTriggerFalling));
+    if (!block_change) {
+        emit changed();
+    }
+}
+
+void functionGraphicDrawer::on_doubleSpinBox_trigger_level_valueChanged(double arg1)
+{
+    widget_scope_drawer->setTriggerLevel(arg1);
+    if (!block_change) {
+        emit changed();
+    }
+}
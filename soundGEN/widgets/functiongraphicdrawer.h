@@ -3,15 +3,17 @@
 
 #include <QWidget>
 #include "../sndcontroller.h"
-#include "../classes/graphicthread.h"
+#include "../classes/framescheduler.h"
 #include "./mgraphicdrawsurface.h"
 #include "./mfftdrawsurface.h"
+#include "./mspectrogramdrawsurface.h"
+#include "./mscopedrawsurface.h"
 
 namespace Ui {
 class functionGraphicDrawer;
 }
 
-class functionGraphicDrawer : public QWidget
+class functionGraphicDrawer : public QWidget, public FrameSchedulerClient
 {
     Q_OBJECT
 public:
@@ -36,12 +38,40 @@ public:
 
     bool isFft();
     void setFft(bool value);
+
+    int getFftAverageMode() const;
+    void setFftAverageMode(int value);
+
+    int getFftScale() const;
+    void setFftScale(int value);
+
+    bool isSpectrogram();
+    void setSpectrogram(bool value);
+
+    bool isScope();
+    void setScope(bool value);
+
+    int getTrigger() const;
+    void setTrigger(int value);
+    double getTriggerLevel() const;
+    void setTriggerLevel(double value);
+
+    void setChannel(unsigned int value);
+
+    virtual bool frameActive();
+    virtual bool frameNeeded();
+    virtual bool frameVisible();
+    virtual void frameStep();
 private:
     Ui::functionGraphicDrawer *ui;
-    static graphicThread *mThread;
+    bool running, final_frame;
+    quint32 tap_position;
     MGraphicDrawSurface *widget_drawer;
     MFftDrawSurface *widget_fft_drawer;
+    MSpectrogramDrawSurface *widget_spectrogram_drawer;
+    MScopeDrawSurface *widget_scope_drawer;
     bool block_change;
+    void updateMode();
 signals:
     void changed();
 public slots:
@@ -53,7 +83,13 @@ private slots:
     void on_ampSlider_valueChanged(int value);
     void on_checkBox_grouped_stateChanged(int arg1);
     void on_checkBox_fft_stateChanged(int arg1);
+    void on_checkBox_spectrogram_stateChanged(int arg1);
     void on_durationSlider_fft_valueChanged(int value);
+    void on_comboBox_fft_average_currentIndexChanged(int index);
+    void on_comboBox_fft_scale_currentIndexChanged(int index);
+    void on_checkBox_scope_stateChanged(int arg1);
+    void on_comboBox_trigger_currentIndexChanged(int index);
+    void on_doubleSpinBox_trigger_level_valueChanged(double arg1);
 };
 
 #endif // FUNCTIONGRAPHICDRAWER_H
@@ -1,30 +1,40 @@
 #include "mfftdrawsurface.h"
+#include <algorithm>
+
+/* lowest frequency of the logarithmic axis */
+const double MFftDrawSurface::log_min_freq = 20;
+/* 1/12 octave bands */
+const double MFftDrawSurface::constant_q = 17.3;
 
 MFftDrawSurface::MFftDrawSurface() :
     MGraphicDrawSurface()
 {
     timer_interval = 30;
-    draw_result = 0;
     draw_size = 0;
     last_fmod_dt = -1;
     t = 0;
     dt = 0;
     next_dt = 0.5;
-    data = data_buffer = data_top = 0;
     round_interval_dt = ceil(timer_interval*0.001);
     grid_k = 0.5;
     max_y = 0;
     max_y_axis = 1;
-    analyzer = new SndAnalyzer();
-    analyzer->setTop_harmonic(5);
-    analyzer->setAmp_filter(0.0001);
+    worker = new FftThread();
+    channel = 0;
+    worker->attachFrames(&current, &next);
+    current_valid = next_valid = false;
+    scale = FftScaleLinear;
+    table_bins = -1;
+    table_f1 = 0;
+    table_scale = scale;
+    axis_f0 = 0;
+    decimation_dirty = true;
+    connect(worker, SIGNAL(ready()), this, SLOT(update()));
 }
 
 MFftDrawSurface::~MFftDrawSurface()
 {
-    if (data)     delete data;
-    if (data_top) delete data_top;
-    delete analyzer;
+    delete worker;
 }
 
 void MFftDrawSurface::setTimerInterval(long int interval)
@@ -42,31 +52,91 @@ void MFftDrawSurface::setDt(double value)
     next_dt = value;
 }
 
+MFftAverageMode MFftDrawSurface::getAverageMode() const
+{
+    return worker->getAverageMode();
+}
+
+void MFftDrawSurface::setAverageMode(MFftAverageMode value)
+{
+    if (worker->getAverageMode()!=value) {
+        worker->setAverageMode(value);
+        last_fmod_dt = -1;
+    }
+}
+
+MFftScale MFftDrawSurface::getScale() const
+{
+    return scale;
+}
+
+void MFftDrawSurface::setScale(MFftScale value)
+{
+    scale = value;
+    update();
+}
+
+unsigned int MFftDrawSurface::getChannel() const
+{
+    return channel;
+}
+
+void MFftDrawSurface::setChannel(unsigned int value)
+{
+    if (channel!=value) {
+        worker->cancel();
+        worker->resetAverage();
+        current_valid = next_valid = false;
+    }
+    channel = value;
+}
+
+/*
+    Spectra are taken from the tap like the scope and the spectrogram do, so channel
+    functions are only evaluated by the audio thread. An interval that isn't rendered
+    yet is replaced by the newest rendered samples.
+*/
+void MFftDrawSurface::requestSpectrum(double t1)
+{
+    SndController *sc = SndController::Instance();
+    SndRingBuffer *tap = sc->getTap();
+    double frequency = sc->getFrequency();
+    unsigned int points = qMin((unsigned int) floor(dt*frequency), tap->getCapacity()/2);
+    if (channel>=tap->getChannelsCount() || points<4) return;
+
+    worker->request(tap, channel, (quint32) round(t1*frequency), points, frequency);
+}
+
+/*
+    At the start of every interval the spectrum computed for it becomes current and
+    the next one is requested. Until the worker delivers it, the current one is shown.
+*/
 void MFftDrawSurface::recalcData()
 {
     double cfmod = fmod(t, round_interval_dt);
-    if (last_fmod_dt>cfmod && graphicFunction) {
-        if (data) {
-            delete data;
-            data = 0;
-        }
-        if (data_top) {
-            delete data_top;
-            data_top = 0;
+    if (last_fmod_dt>cfmod && SndController::Instance()->running()) {
+        if (next_valid) {
+            FftFrame *tmp = current;
+            current = next;
+            next = tmp;
+            next_valid = false;
+            decimation_dirty = true;
         }
-        if (!analyzer->getHarmonics() || analyzer->getHarmonics()->isEmpty()) {
-            analyzer->function_fft_base(graphicFunction, base_play_sound, t, t+dt, freq, floor(dt*SndController::Instance()->getFrequency()));
-        }
-        if (analyzer->getHarmonics()) {
-            data = new QVector<HarmonicInfo>(*(analyzer->getHarmonics()));
-        }
-        if (analyzer->getTopHarmonics()) {
-            data_top = new QVector<HarmonicInfo>(*(analyzer->getTopHarmonics()));
-        }
-        analyzer->function_fft_base(graphicFunction, base_play_sound, t+dt, t+2*dt, freq, floor(dt*SndController::Instance()->getFrequency()));
-        data_buffer = analyzer->getHarmonics();
+        requestSpectrum(t+dt);
     }
     last_fmod_dt = cfmod;
+
+    if (worker->takeResult(&next)) {
+        next_valid = true;
+        decimation_dirty = true;
+        if (!current_valid) {
+            FftFrame *tmp = current;
+            current = next;
+            next = tmp;
+            current_valid = true;
+            next_valid = false;
+        }
+    }
 }
 
 void MFftDrawSurface::incT()
@@ -77,7 +147,8 @@ void MFftDrawSurface::incT()
         dt = next_dt;
         round_interval_dt = ceil((ceil((dt*500)/timer_interval) / 1000.0) * timer_interval);
         last_fmod_dt = -1;
-        analyzer->clearHarmonics();
+        worker->resetAverage();
+        current_valid = next_valid = false;
     }
     recalcData();
 }
@@ -92,43 +163,44 @@ void MFftDrawSurface::paintEvent(QPaintEvent *e)
     painter.setBackground(QBrush(Qt::white));
     painter.setPen(Qt::black);
     painter.drawRect(rect().left(),rect().top(),rect().right()-1,rect().bottom()-1);
-    if (!data || data->isEmpty()) return;
-    if (!data_buffer || data_buffer->isEmpty()) return;
+    if (!current_valid || current->harmonics.isEmpty()) return;
     if (last_fmod_dt<0) return;
+    if (width()<=10) return;
+
+    /* without a fresh spectrum for the next interval the current one is held */
+    const QVector<HarmonicInfo> &data = current->harmonics;
+    const QVector<HarmonicInfo> &data_buffer = next_valid && next->harmonics.size()==data.size() ? next->harmonics : data;
+    const QVector<HarmonicInfo> &data_top = current->top;
+
+    draw_size = width()-10;
+    if (draw_result.size()<(int) draw_size) draw_result.resize(draw_size);
 
-    if (draw_size!=width()-10 && draw_result) {
-        delete [] draw_result;
-        draw_result = 0;
-        draw_size = 0;
+    double f1 = data.last().freq;
+    if (table_bins!=data.size() || table_f1!=f1 || table_scale!=scale || pixel_ranges.size()!=(int) draw_size) {
+        updatePixelTable(data);
     }
-    if (!draw_result) {
-        draw_size = width()-10;
-        draw_result = new double[draw_size];
+    bool held = &data_buffer==&data;
+    if (decimation_dirty) {
+        decimate(data, &current_pixels);
+        if (!held) decimate(data_buffer, &next_pixels);
+        decimation_dirty = false;
     }
 
     QFontMetrics fm(painter.font());
     int height_center = height()-fm.height()-5;
 
-    unsigned int i, j;
-    double x0, y0, x1, y1;
+    unsigned int i;
+    double x0, y0, y1;
 
-    double f0 = 0;
-    double fc = f0;
-    double f1 = data->last().freq;
-    double f_axis = calculateTGrid(f1);
-    unsigned int pixel_count = floor(data->size()/draw_size);
-    if (pixel_count<=0) pixel_count = 1;
+    double k_fade = last_fmod_dt/round_interval_dt;
+    const double *cur = current_pixels.constData();
+    const double *nxt = held ? cur : next_pixels.constData();
+    double *result = draw_result.data();
 
     for(i=0;i<draw_size;i++) {
-        draw_result[i] = 0;
-        for(j=0;j<pixel_count;j++) {
-            y0 = (1-last_fmod_dt/round_interval_dt) * data->at(i*pixel_count+j).amp + (last_fmod_dt/round_interval_dt) * data_buffer->at(i*pixel_count+j).amp;
-            if (y0>draw_result[i]) {
-                draw_result[i] = y0;
-            }
-        }
-        if (draw_result[i]>max_y) {
-            max_y = draw_result[i];
+        result[i] = (1-k_fade) * cur[i] + k_fade * nxt[i];
+        if (result[i]>max_y) {
+            max_y = result[i];
             max_y_axis = -1;
         }
     }
@@ -151,39 +223,157 @@ void MFftDrawSurface::paintEvent(QPaintEvent *e)
         y0+=max_y_axis;
     } while (y0<=max_y);
 
-    do {
-        QString axis_num = QString::number(round(fc*10)/10);
-        x0 = (fc/f1) * draw_size + 5;
-        painter.drawLine(x0,0,x0,height_center+2);
-        painter.drawText(x0-0.5*fm.width(axis_num)+1, height_center+fm.height()+1, axis_num);
-        fc+=f_axis;
-    } while (fc<=f1);
+    if (scale==FftScaleLinear || axis_f0<=0) {
+        double fc = 0;
+        double f_axis = calculateTGrid(f1);
+        do {
+            QString axis_num = QString::number(round(fc*10)/10);
+            x0 = frequencyToX(fc, f1);
+            painter.drawLine(x0,0,x0,height_center+2);
+            painter.drawText(x0-0.5*fm.width(axis_num)+1, height_center+fm.height()+1, axis_num);
+            fc+=f_axis;
+        } while (fc<=f1);
+    } else {
+        /* 1-2-5 steps of every decade */
+        static const double steps[3] = {1, 2, 5};
+        double decade = pow(10, floor(log10(axis_f0)));
+        double fc;
+        for(; decade<=f1; decade*=10) {
+            for(i=0;i<3;i++) {
+                fc = decade*steps[i];
+                if (fc<axis_f0 || fc>f1) continue;
+                QString axis_num = fc>=1000 ? QString::number(fc/1000)+"k" : QString::number(fc);
+                x0 = frequencyToX(fc, f1);
+                painter.drawLine(x0,0,x0,height_center+2);
+                painter.drawText(x0-0.5*fm.width(axis_num)+1, height_center+fm.height()+1, axis_num);
+            }
+        }
+    }
 
     painter.setPen(QPen(QBrush(Qt::red), 2));
 
-    x1 = 5;
-    y1 = height_center * (1 - draw_result[0]);
-    for(i=1;i<draw_size;i++) {
-        x0 = x1;
-        y0 = y1;
-        x1 = i+5;
-        y1 = height_center * (1 - 0.95*k_y*draw_result[i]);
-        painter.drawLine(x0,y0,x1,y1);
+    waveform_polyline.resize(draw_size);
+    for(i=0;i<draw_size;i++) {
+        waveform_polyline[i] = QPointF(i+5, height_center * (1 - 0.95*k_y*result[i]));
     }
+    painter.drawPolyline(waveform_polyline.constData(), draw_size);
 
-    if (data_top && !data_top->isEmpty()) {
+    if (!data_top.isEmpty()) {
         int max_top_width = fm.width("00000.0"+tr("Hz")+" -> 0.0000");
         int tmp_top_width = fm.width(tr("Top harmonics:"));
         if (tmp_top_width>max_top_width) max_top_width = tmp_top_width;
         max_top_width+=15;
         painter.setBrush(QColor(0, 0, 255, 150));
         painter.setPen(Qt::blue);
-        painter.drawRect(rect().right()-10-max_top_width,rect().top()+10,max_top_width,10+(data_top->size()+1)*(fm.height()+5));
+        painter.drawRect(rect().right()-10-max_top_width,rect().top()+10,max_top_width,10+(data_top.size()+1)*(fm.height()+5));
         painter.setPen(Qt::yellow);
         painter.drawText(rect().right()-max_top_width, rect().top()+25, tr("Top harmonics:"));
         painter.setPen(Qt::white);
-        for(i=0;i<data_top->size();i++) {
-            painter.drawText(rect().right()-max_top_width, rect().top()+30+(i+1)*(fm.height()+5), QString::number(data_top->at(i).freq, 'f', 1) + tr("Hz") + " -> " + QString::number(data_top->at(i).amp, 'f', 4));
+        for(i=0;i<data_top.size();i++) {
+            painter.drawText(rect().right()-max_top_width, rect().top()+30+(i+1)*(fm.height()+5), QString::number(data_top.at(i).freq, 'f', 1) + tr("Hz") + " -> " + QString::number(data_top.at(i).amp, 'f', 4));
+        }
+    }
+}
+
+double MFftDrawSurface::frequencyToX(double f, double f1) const
+{
+    if (scale==FftScaleLinear || axis_f0<=0) {
+        return (f/f1) * draw_size + 5;
+    }
+    return log(f/axis_f0)/log(f1/axis_f0) * draw_size + 5;
+}
+
+static bool harmonic_freq_less(const HarmonicInfo &a, double f)
+{
+    return a.freq<f;
+}
+
+/*
+    Maps every pixel to its bins once per spectrum layout, so drawing doesn't
+    depend on the number of bins.
+*/
+void MFftDrawSurface::updatePixelTable(const QVector<HarmonicInfo> &spectrum)
+{
+    const HarmonicInfo *begin = spectrum.constData();
+    const HarmonicInfo *end = begin + spectrum.size();
+    unsigned int bins = spectrum.size();
+    double f1 = spectrum.last().freq;
+    double fa, fb, fc, pos;
+    unsigned int i, from, to;
+
+    table_bins = bins;
+    table_f1 = f1;
+    table_scale = scale;
+    axis_f0 = 0;
+    if (scale!=FftScaleLinear) {
+        axis_f0 = qMax(log_min_freq, begin[qMin(1u, bins-1)].freq);
+        if (axis_f0>=f1) axis_f0 = 0;
+    }
+
+    pixel_ranges.resize(draw_size);
+    for(i=0;i<draw_size;i++) {
+        if (axis_f0<=0) {
+            fa = f1*i/draw_size;
+            fb = f1*(i+1)/draw_size;
+        } else {
+            fa = axis_f0*pow(f1/axis_f0, (double) i/draw_size);
+            fb = axis_f0*pow(f1/axis_f0, (double) (i+1)/draw_size);
+        }
+        if (scale==FftScaleConstantQ && axis_f0>0) {
+            /* band of constant relative width, wider than the pixel at low frequencies */
+            fc = sqrt(fa*fb);
+            fa = qMin(fa, fc*(1-0.5/constant_q));
+            fb = qMax(fb, fc*(1+0.5/constant_q));
+        }
+        from = std::lower_bound(begin, end, fa, harmonic_freq_less) - begin;
+        to = std::lower_bound(begin, end, fb, harmonic_freq_less) - begin;
+        from = qMin(from, bins-1);
+        pixel_ranges[i].from = from;
+        pixel_ranges[i].to = qMax(qMin(to, bins), from);
+        pixel_ranges[i].k = 0;
+
+        if (pixel_ranges[i].to==from && from>0) {
+            /* narrower than a bin: interpolate at the pixel center */
+            fc = 0.5*(fa+fb);
+            pixel_ranges[i].from = from-1;
+            pixel_ranges[i].to = from-1;
+            pos = (fc-begin[from-1].freq)/(begin[from].freq-begin[from-1].freq);
+            pixel_ranges[i].k = qBound(0.0, pos, 1.0);
+        } else if (pixel_ranges[i].to==from) {
+            pixel_ranges[i].to = from+1;
+        }
+    }
+    decimation_dirty = true;
+}
+
+/* peaks of the pixel bins, or the band power in constant-Q mode */
+void MFftDrawSurface::decimate(const QVector<HarmonicInfo> &spectrum, QVector<double> *pixels)
+{
+    const HarmonicInfo *bin = spectrum.constData();
+    const MFftPixelRange *range = pixel_ranges.constData();
+    unsigned int bins = spectrum.size();
+    unsigned int i, j, last;
+    bool power = scale==FftScaleConstantQ && axis_f0>0;
+    double v;
+
+    if (pixels->size()<pixel_ranges.size()) pixels->resize(pixel_ranges.size());
+    double *out = pixels->data();
+
+    for(i=0;i<(unsigned int) pixel_ranges.size();i++) {
+        if (range[i].to==range[i].from) {
+            last = qMin(range[i].from+1, bins-1);
+            out[i] = (1-range[i].k)*bin[range[i].from].amp + range[i].k*bin[last].amp;
+            continue;
+        }
+        v = 0;
+        last = qMin(range[i].to, bins);
+        for(j=range[i].from;j<last;j++) {
+            if (power) {
+                v += bin[j].amp*bin[j].amp;
+            } else if (bin[j].amp>v) {
+                v = bin[j].amp;
+            }
         }
+        out[i] = power ? sqrt(v) : v;
     }
 }
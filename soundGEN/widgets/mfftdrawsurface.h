@@ -3,16 +3,43 @@
 
 #include "mgraphicdrawsurface.h"
 #include "../classes/sndanalyzer.h"
+#include "../classes/fftthread.h"
+
+/*
+    FftScaleLinear: linear frequency axis, every pixel shows the peak of its bins.
+    FftScaleLog: logarithmic frequency axis, peaks as well.
+    FftScaleConstantQ: logarithmic axis, every pixel shows the power of a band
+    with constant relative bandwidth around its frequency.
+*/
+enum MFftScale { FftScaleLinear, FftScaleLog, FftScaleConstantQ };
+
+/* bins [from, to) of one pixel; from==to: interpolated between bins from and from+1 by k */
+struct MFftPixelRange {
+    unsigned int from, to;
+    double k;
+};
 
 class MFftDrawSurface : public MGraphicDrawSurface
 {
     Q_OBJECT
 private:
-    SndAnalyzer *analyzer;
-    QVector<HarmonicInfo>* data;
-    QVector<HarmonicInfo>* data_buffer;
-    QVector<HarmonicInfo>* data_top;
-    double* draw_result;
+    FftThread *worker;
+    unsigned int channel;
+    /* spectra at the start of the current and of the next interval, owned until exchanged */
+    FftFrame *current, *next;
+    bool current_valid, next_valid;
+    QVector<double> draw_result;
+    MFftScale scale;
+    static const double log_min_freq;
+    static const double constant_q;
+    /* bin -> pixel table, rebuilt only when the spectrum layout or the width changes */
+    QVector<MFftPixelRange> pixel_ranges;
+    int table_bins;
+    double table_f1;
+    MFftScale table_scale;
+    double axis_f0;
+    QVector<double> current_pixels, next_pixels;
+    bool decimation_dirty;
     double last_fmod_dt;
     double round_interval_dt;
     double next_dt;
@@ -20,12 +47,22 @@ private:
     unsigned int draw_size;
     long int timer_interval;
     void recalcData();
+    void requestSpectrum(double t1);
+    void updatePixelTable(const QVector<HarmonicInfo> &spectrum);
+    void decimate(const QVector<HarmonicInfo> &spectrum, QVector<double> *pixels);
+    double frequencyToX(double f, double f1) const;
 public:
     explicit MFftDrawSurface();
     ~MFftDrawSurface();
     void setTimerInterval(long int interval);
     virtual double getDt() const;
     void setDt(double value);
+    MFftAverageMode getAverageMode() const;
+    void setAverageMode(MFftAverageMode value);
+    MFftScale getScale() const;
+    void setScale(MFftScale value);
+    unsigned int getChannel() const;
+    void setChannel(unsigned int value);
     void incT();
 protected:
     virtual void paintEvent(QPaintEvent* e);
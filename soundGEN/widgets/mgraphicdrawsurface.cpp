@@ -84,18 +84,22 @@ void MGraphicDrawSurface::incT()
 
 void MGraphicDrawSurface::setGraphicFunction(GenSoundFunction value)
 {
+    /* the old function may belong to a library that is going to be unloaded */
+    if (waveform && (graphicFunction!=value || graphicTFunction)) waveform->cancel();
     graphicFunction = value;
     graphicTFunction = 0;
 }
 
 void MGraphicDrawSurface::setGraphicFunctionT(base_function_signal value)
 {
+    if (waveform && (graphicTFunction!=value || graphicFunction)) waveform->cancel();
     graphicTFunction = value;
     graphicFunction = 0;
 }
 
 void MGraphicDrawSurface::resetGraphicFunctions()
 {
+    if (waveform && (graphicTFunction || graphicFunction)) waveform->cancel();
     graphicTFunction = 0;
     graphicFunction = 0;
 }
@@ -104,6 +108,7 @@ MGraphicDrawSurface::MGraphicDrawSurface() :
     QWidget()
 {
     grid_k = 1;
+    waveform = 0;
 }
 
 double MGraphicDrawSurface::calculateTGrid(double cl_dt)
@@ -147,46 +152,93 @@ void MGraphicDrawSurface::paintEvent(QPaintEvent *e)
     painter.drawRect(rect().left(),rect().top(),rect().right()-1,rect().bottom()-1);
     if (!graphicFunction && !graphicTFunction) return;
 
+    drawGrid(&painter, t);
+    drawWaveform(&painter);
+}
+
+void MGraphicDrawSurface::drawGrid(QPainter *painter, double t_from)
+{
     int points_count = 2 * width() - 1;
     int height_center = height() / 2;
-    double k_y_graphic = kamp * amp * 0.4 * height();
     double k_t_graphic = dt/points_count;
-    double kFreq = freq*2.0*M_PI;
-
-    int i;
-    double x0, y0, x1, y1;
+    double x0;
 
-    double t_axis = floor(t/dt_axis) * dt_axis;
-    double next_t = t+dt;
+    double t_axis = floor(t_from/dt_axis) * dt_axis;
+    double next_t = t_from+dt;
 
 
-    painter.drawLine(0,height_center,points_count,height_center);
+    painter->drawLine(0,height_center,points_count,height_center);
 
     do {
         t_axis+=dt_axis;
-        x0 = 0.5*(t_axis-t)/k_t_graphic;
-        painter.drawLine(x0,0,x0,height_center*2);
-        painter.drawText(x0+5, height_center+5, QString::number(round(t_axis*100000)/100000));
-        painter.drawText(x0+5, 15, QString::number(round(t_axis*100000)/100000));
+        x0 = 0.5*(t_axis-t_from)/k_t_graphic;
+        painter->drawLine(x0,0,x0,height_center*2);
+        painter->drawText(x0+5, height_center+5, QString::number(round(t_axis*100000)/100000));
+        painter->drawText(x0+5, 15, QString::number(round(t_axis*100000)/100000));
     } while (t_axis<=next_t);
+}
 
-    painter.setPen(QPen(QBrush(Qt::red), 2));
+/*
+    The function is evaluated by WaveformThread as min/max per pixel column,
+    here the cached columns are only scaled and drawn as one polyline.
+*/
+void MGraphicDrawSurface::drawWaveform(QPainter *painter)
+{
+    if (!waveform) {
+        waveform = new WaveformCache(this);
+        connect(waveform, SIGNAL(ready()), this, SLOT(update()));
+    }
 
-    x1 = 0;
-    if (graphicFunction)
-        y1 = height_center - k_y_graphic*graphicFunction(t, kFreq, freq, base_play_sound);
-    else
-        y1 = height_center - k_y_graphic*graphicTFunction(kFreq*t);
+    WaveformParams params;
+    params.fct = graphicFunction;
+    params.tfct = graphicFunction ? 0 : graphicTFunction;
+    params.t = t;
+    params.dt = dt;
+    params.freq = freq;
+    params.columns = width();
+    waveform->request(params);
 
-    for(i=1;i<points_count;i++) {
-        x0 = x1;
-        y0 = y1;
-        x1 = i/2;
+    WaveformParams computed;
+    if (!waveform->getResult(&computed, &waveform_minmax)) return;
+    if (computed.fct!=params.fct || computed.tfct!=params.tfct || computed.freq!=params.freq
+            || computed.dt!=params.dt || computed.dt<=0 || computed.columns<=0) return;
 
-        if (graphicFunction)
-            y1 = height_center - k_y_graphic*graphicFunction(t+i*k_t_graphic, kFreq, freq, base_play_sound);
-        else
-            y1 = height_center - k_y_graphic*graphicTFunction((t+i*k_t_graphic)*kFreq);
-        painter.drawLine(x0,y0,x1,y1);
+    /* until the new columns are ready the previous ones are shifted to the current t */
+    int shift = (int) round((computed.t-t)/computed.dt*computed.columns);
+    drawColumns(painter, waveform_minmax.constData(), computed.columns, shift, kamp * amp * 0.4 * height());
+}
+
+/*
+    Draws min/max pairs of every column as one polyline, value 1.0 is k_y pixels
+    above the center line.
+*/
+void MGraphicDrawSurface::drawColumns(QPainter *painter, const float *minmax, int columns, double shift, double k_y)
+{
+    int height_center = height() / 2;
+    int c, count = 0;
+    double x;
+    float y_min, y_max, y_last = height_center;
+
+    waveform_polyline.resize(2*columns);
+    for(c = 0; c<columns; c++) {
+        x = c + shift;
+        if (x<0 || x>=width()) continue;
+        y_min = height_center - k_y*minmax[2*c];
+        y_max = height_center - k_y*minmax[2*c+1];
+
+        /* keep the end of one column next to the start of the next one */
+        if (qAbs(y_max-y_last)<qAbs(y_min-y_last)) {
+            waveform_polyline[count++] = QPointF(x, y_max);
+            waveform_polyline[count++] = QPointF(x, y_min);
+            y_last = y_min;
+        } else {
+            waveform_polyline[count++] = QPointF(x, y_min);
+            waveform_polyline[count++] = QPointF(x, y_max);
+            y_last = y_max;
+        }
     }
+    if (count<2) return;
+
+    painter->setPen(QPen(QBrush(Qt::red), 2));
+    painter->drawPolyline(waveform_polyline.constData(), count);
 }
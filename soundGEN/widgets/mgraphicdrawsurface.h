@@ -6,6 +6,7 @@
 #include <math.h>
 #include "../base_functions.h"
 #include "../sndcontroller.h"
+#include "../classes/waveformthread.h"
 
 class MGraphicDrawSurface : public QWidget
 {
@@ -15,7 +16,13 @@ protected:
     double grid_k;
     GenSoundFunction graphicFunction;
     base_function_signal graphicTFunction;
+    WaveformCache *waveform;
+    QVector<float> waveform_minmax;
+    QPolygonF waveform_polyline;
     double calculateTGrid(double cl_dt);
+    void drawGrid(QPainter *painter, double t_from);
+    void drawWaveform(QPainter *painter);
+    void drawColumns(QPainter *painter, const float *minmax, int columns, double shift, double k_y);
 public:
     explicit MGraphicDrawSurface();
 
@@ -0,0 +1,176 @@
+#include "mlevelmeter.h"
+
+const double MLevelMeter::min_db = -60;
+const double MLevelMeter::max_db = 6;
+const double MLevelMeter::rms_seconds = 0.3;
+const double MLevelMeter::hold_seconds = 1.5;
+const double MLevelMeter::fall_db_per_second = 20;
+
+MLevelMeter::MLevelMeter(unsigned int channel, QWidget *parent) :
+    QWidget(parent)
+{
+    this->channel = channel;
+    peak_db = rms_db = hold_db = min_db;
+    hold_time = last_frame = 0;
+    last_block = 0;
+    clips = 0;
+    clock.start();
+
+    setMinimumWidth(12);
+    setMaximumWidth(18);
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+    setToolTip(tr("Peak/RMS level, click to reset clipping"));
+
+    FrameScheduler::Instance()->addClient(this);
+}
+
+MLevelMeter::~MLevelMeter()
+{
+    FrameScheduler::Instance()->removeClient(this);
+}
+
+unsigned int MLevelMeter::getChannel() const
+{
+    return channel;
+}
+
+void MLevelMeter::setChannel(unsigned int value)
+{
+    channel = value;
+}
+
+void MLevelMeter::start()
+{
+    last_frame = clock.elapsed();
+    last_block = positionBlock()-1;
+    FrameScheduler::Instance()->requestFrame();
+}
+
+/* meter block at the playback position */
+quint32 MLevelMeter::positionBlock() const
+{
+    SndController *sc = SndController::Instance();
+    return ((quint32) (sc->getT()*sc->getFrequency()))/sc->getLevelMeter()->getBlockFrames();
+}
+
+double MLevelMeter::levelToDb(double level) const
+{
+    return level>0 ? qMax(20*log10(level), min_db) : min_db;
+}
+
+int MLevelMeter::dbToY(double db) const
+{
+    int h = height()-clip_box_height-3;
+    return clip_box_height+2 + (int) (h*(max_db-qBound(min_db, db, max_db))/(max_db-min_db));
+}
+
+bool MLevelMeter::frameActive()
+{
+    /* after stopping, keep going until the bars have fallen */
+    return SndController::Instance()->running() || peak_db>min_db || rms_db>min_db || hold_db>min_db;
+}
+
+bool MLevelMeter::frameNeeded()
+{
+    /* levels change once per meter block */
+    return !SndController::Instance()->running() || positionBlock()!=last_block;
+}
+
+bool MLevelMeter::frameVisible()
+{
+    return isVisible() && !window()->isMinimized();
+}
+
+void MLevelMeter::frameStep()
+{
+    SndController *sc = SndController::Instance();
+    SndLevelMeter *meter = sc->getLevelMeter();
+    qint64 now = clock.elapsed();
+    double elapsed = qMax(now-last_frame, (qint64) 0) / 1000.0;
+    double new_peak_db = min_db, new_rms_db = min_db;
+    double peak, rms;
+    unsigned int shown_clips = clips;
+    int peak_y = dbToY(peak_db), rms_y = dbToY(rms_db), hold_y = dbToY(hold_db);
+    last_frame = now;
+
+    if (sc->running()) {
+        double frequency = sc->getFrequency();
+        quint32 position = (quint32) (sc->getT()*frequency);
+        last_block = position/meter->getBlockFrames();
+        quint32 peak_frames = qMax((quint32) (elapsed*frequency), (quint32) meter->getBlockFrames());
+
+        if (meter->getLevels(channel, position-peak_frames, position, &peak, &rms)) {
+            new_peak_db = levelToDb(peak);
+        }
+        if (meter->getLevels(channel, position-(quint32) (rms_seconds*frequency), position, &peak, &rms)) {
+            new_rms_db = levelToDb(rms);
+        }
+        if (clips!=meter->getClipCount(channel)) {
+            clips = meter->getClipCount(channel);
+            setToolTip(tr("Clipped samples: %1, click to reset").arg(clips));
+        }
+    }
+
+    double fall = fall_db_per_second*elapsed;
+    peak_db = qMax(new_peak_db, peak_db-fall);
+    rms_db = qMax(new_rms_db, rms_db-fall);
+    if (new_peak_db>=hold_db) {
+        hold_db = new_peak_db;
+        hold_time = now;
+    } else if (now-hold_time>hold_seconds*1000) {
+        hold_db = qMax(hold_db-fall, peak_db);
+    }
+
+    /* e.g. a silent channel doesn't need to be painted again */
+    if (peak_y!=dbToY(peak_db) || rms_y!=dbToY(rms_db) || hold_y!=dbToY(hold_db) || shown_clips!=clips) {
+        update();
+    }
+}
+
+void MLevelMeter::paintEvent(QPaintEvent *e)
+{
+    QWidget::paintEvent(e);
+
+    QPainter painter(this);
+    int w = width(), bottom = dbToY(min_db);
+
+    painter.fillRect(0, 0, w, height(), QColor(40, 40, 40));
+    painter.fillRect(1, 1, w-2, clip_box_height, clips>0 ? QColor(255, 0, 0) : QColor(90, 0, 0));
+
+    /* peak bar, coloured by zones */
+    static const double zone_db[3] = {-12, -3, max_db};
+    static const QRgb zone_color[3] = {qRgb(0, 190, 0), qRgb(230, 200, 0), qRgb(240, 0, 0)};
+    double from_db = min_db;
+    int i, y0, y1;
+    for(i = 0; i<3 && from_db<peak_db; i++) {
+        y0 = dbToY(qMin(peak_db, zone_db[i]));
+        y1 = dbToY(from_db);
+        painter.fillRect(1, y0, w-2, y1-y0, QColor(zone_color[i]));
+        from_db = zone_db[i];
+    }
+
+    /* RMS as a darker bar inside the peak bar */
+    if (rms_db>min_db) {
+        y0 = dbToY(rms_db);
+        painter.fillRect(w/4, y0, w-2*(w/4), bottom-y0, QColor(0, 90, 0));
+    }
+
+    if (hold_db>min_db) {
+        painter.setPen(Qt::white);
+        painter.drawLine(1, dbToY(hold_db), w-2, dbToY(hold_db));
+    }
+
+    /* full scale mark */
+    painter.setPen(QColor(160, 160, 160));
+    painter.drawLine(0, dbToY(0), w, dbToY(0));
+}
+
+void MLevelMeter::mousePressEvent(QMouseEvent *e)
+{
+    QWidget::mousePressEvent(e);
+    SndController::Instance()->getLevelMeter()->resetClipCount(channel);
+    clips = 0;
+    hold_db = peak_db;
+    setToolTip(tr("Peak/RMS level, click to reset clipping"));
+    update();
+}
@@ -0,0 +1,54 @@
+#ifndef MLEVELMETER_H
+#define MLEVELMETER_H
+
+#include <QWidget>
+#include <QPainter>
+#include <QElapsedTimer>
+#include <math.h>
+#include "../sndcontroller.h"
+#include "../classes/framescheduler.h"
+
+/*
+    Vertical peak/RMS meter of one rendered channel. Levels come from the controller's
+    SndLevelMeter at the current playback position, so nothing is computed per sample here.
+    Peaks rise instantly and fall at a fixed rate, the peak hold line stays for a while.
+    The top box lights up when samples clipped; a click resets it.
+*/
+class MLevelMeter : public QWidget, public FrameSchedulerClient
+{
+    Q_OBJECT
+private:
+    static const double min_db;
+    static const double max_db;
+    static const double rms_seconds;
+    static const double hold_seconds;
+    static const double fall_db_per_second;
+    static const int clip_box_height = 8;
+    unsigned int channel;
+    double peak_db, rms_db, hold_db;
+    qint64 hold_time, last_frame;
+    quint32 last_block;
+    unsigned int clips;
+    QElapsedTimer clock;
+    quint32 positionBlock() const;
+    double levelToDb(double level) const;
+    int dbToY(double db) const;
+public:
+    explicit MLevelMeter(unsigned int channel = 0, QWidget *parent = 0);
+    ~MLevelMeter();
+
+    unsigned int getChannel() const;
+    void setChannel(unsigned int value);
+
+    virtual bool frameActive();
+    virtual bool frameNeeded();
+    virtual bool frameVisible();
+    virtual void frameStep();
+public slots:
+    void start();
+protected:
+    virtual void paintEvent(QPaintEvent* e);
+    virtual void mousePressEvent(QMouseEvent* e);
+};
+
+#endif // MLEVELMETER_H
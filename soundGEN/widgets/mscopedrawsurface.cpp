@@ -0,0 +1,182 @@
+#include "mscopedrawsurface.h"
+
+const double MScopeDrawSurface::trigger_hysteresis = 0.02;
+const double MScopeDrawSurface::min_search_seconds = 0.05;
+
+MScopeDrawSurface::MScopeDrawSurface() :
+    MGraphicDrawSurface()
+{
+    channel = 0;
+    trigger = ScopeTriggerRising;
+    trigger_level = 0;
+    triggered = false;
+    frames = 0;
+    samples_start = 0;
+    trigger_offset = 0;
+    amp = 1;
+    kamp = 1;
+}
+
+unsigned int MScopeDrawSurface::getChannel() const
+{
+    return channel;
+}
+
+void MScopeDrawSurface::setChannel(unsigned int value)
+{
+    channel = value;
+    frames = 0;
+}
+
+MScopeTrigger MScopeDrawSurface::getTrigger() const
+{
+    return trigger;
+}
+
+void MScopeDrawSurface::setTrigger(MScopeTrigger value)
+{
+    trigger = value;
+}
+
+double MScopeDrawSurface::getTriggerLevel() const
+{
+    return trigger_level;
+}
+
+void MScopeDrawSurface::setTriggerLevel(double value)
+{
+    trigger_level = value;
+}
+
+/*
+    Returns the index of the newest sample after a crossing in samples[1..count-1],
+    or -1. The signal must leave the hysteresis band on the other side of the level
+    before the next crossing counts, so noise on a slow edge doesn't retrigger.
+*/
+int MScopeDrawSurface::findTrigger(unsigned int count, double *offset)
+{
+    const float *s = samples.constData();
+    double sign = trigger==ScopeTriggerFalling ? -1 : 1;
+    double level = sign*trigger_level;
+    double prev, curr;
+    bool armed = false;
+    int found = -1;
+    unsigned int i;
+
+    if (!count) return -1;
+    prev = sign*s[0];
+    armed = prev<level-trigger_hysteresis;
+    for(i = 1; i<count; i++) {
+        curr = sign*s[i];
+        if (curr<level-trigger_hysteresis) {
+            armed = true;
+        } else if (armed && prev<level && curr>=level) {
+            found = i;
+            *offset = (level-prev)/(curr-prev);
+            armed = false;
+        }
+        prev = curr;
+    }
+    return found;
+}
+
+void MScopeDrawSurface::incT()
+{
+    if (this->isHidden()) return;
+
+    SndController *sc = SndController::Instance();
+    SndRingBuffer *tap = sc->getTap();
+    if (!sc->running() || channel>=tap->getChannelsCount() || dt<=0) return;
+
+    unsigned int capacity = tap->getCapacity()/2;
+    unsigned int window = qMin((unsigned int) ceil(dt*sc->getFrequency()), capacity);
+    unsigned int search = qMax(window, (unsigned int) (min_search_seconds*sc->getFrequency()));
+    unsigned int count = qMin(window+search, capacity);
+    if (window<2) return;
+
+    if (samples.size()<(int) count) samples.resize(count);
+    if (!tap->readLatest(channel, samples.data(), count)) return;
+
+    int start = count-window;
+    double offset = 0;
+    triggered = false;
+    if (trigger!=ScopeTriggerFree) {
+        /* the crossing lies between samples found-1 and found, it must leave a full window */
+        int found = findTrigger(count-window+1, &offset);
+        if (found>0) {
+            start = found-1;
+            triggered = true;
+        }
+    }
+    samples_start = start;
+    frames = window;
+    trigger_offset = triggered ? offset : 0;
+    calculateColumns();
+}
+
+/*
+    Min/max per pixel column, when a column is narrower than a sample
+    the value is interpolated, so zoomed in signals stay smooth.
+*/
+void MScopeDrawSurface::calculateColumns()
+{
+    int columns = width();
+    if (columns<=0 || frames<2) {
+        columns_minmax.clear();
+        return;
+    }
+
+    const float *s = samples.constData()+samples_start;
+    double samples_per_column = (frames-1.0)/columns;
+    double a, b, k;
+    unsigned int i, i0, i1;
+    float v_min, v_max;
+    int c;
+
+    columns_minmax.resize(2*columns);
+    for(c = 0; c<columns; c++) {
+        a = c*samples_per_column;
+        b = a+samples_per_column;
+        i0 = (unsigned int) a;
+        if (samples_per_column<1) {
+            i1 = qMin(i0+1, frames-1);
+            k = a-i0;
+            v_min = v_max = s[i0]+k*(s[i1]-s[i0]);
+        } else {
+            i1 = qMin((unsigned int) ceil(b), frames-1);
+            v_min = v_max = s[i0];
+            for(i = i0+1; i<=i1; i++) {
+                if (s[i]<v_min) v_min = s[i];
+                if (s[i]>v_max) v_max = s[i];
+            }
+        }
+        columns_minmax[2*c] = v_min;
+        columns_minmax[2*c+1] = v_max;
+    }
+}
+
+void MScopeDrawSurface::paintEvent(QPaintEvent *e)
+{
+    QWidget::paintEvent(e);
+
+    if (this->isHidden()) return;
+
+    QPainter painter(this);
+    painter.setBackground(QBrush(Qt::white));
+    painter.setPen(Qt::black);
+    painter.drawRect(rect().left(),rect().top(),rect().right()-1,rect().bottom()-1);
+
+    drawGrid(&painter, 0);
+
+    double k_y = kamp * 0.4 * height();
+    if (trigger!=ScopeTriggerFree) {
+        int y = height()/2 - k_y*trigger_level;
+        painter.setPen(QPen(triggered ? Qt::darkGreen : Qt::gray, 1, Qt::DashLine));
+        painter.drawLine(0, y, width(), y);
+    }
+
+    if (columns_minmax.size()!=2*width()) return;
+    /* the crossing is between two samples, shift left by its fraction for a stable picture */
+    double shift = -trigger_offset*width()/(frames-1.0);
+    drawColumns(&painter, columns_minmax.constData(), width(), shift, k_y);
+}
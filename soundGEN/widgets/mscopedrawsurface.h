@@ -0,0 +1,50 @@
+#ifndef MSCOPEDRAWSURFACE_H
+#define MSCOPEDRAWSURFACE_H
+
+#include <QWidget>
+#include <QPainter>
+#include <math.h>
+#include "../sndcontroller.h"
+#include "./mgraphicdrawsurface.h"
+
+enum MScopeTrigger { ScopeTriggerFree, ScopeTriggerRising, ScopeTriggerFalling };
+
+/*
+    Oscilloscope view of one rendered channel. Samples are taken from the controller tap,
+    so nothing is synthesized for drawing. With an edge trigger the window starts at
+    the newest crossing of the trigger level that still leaves dt seconds to show.
+*/
+class MScopeDrawSurface : public MGraphicDrawSurface
+{
+    Q_OBJECT
+private:
+    static const double trigger_hysteresis;
+    static const double min_search_seconds;
+    unsigned int channel;
+    MScopeTrigger trigger;
+    double trigger_level;
+    bool triggered;
+    QVector<float> samples;
+    QVector<float> columns_minmax;
+    unsigned int samples_start, frames;
+    double trigger_offset;
+    int findTrigger(unsigned int count, double *offset);
+    void calculateColumns();
+public:
+    explicit MScopeDrawSurface();
+
+    unsigned int getChannel() const;
+    void setChannel(unsigned int value);
+
+    MScopeTrigger getTrigger() const;
+    void setTrigger(MScopeTrigger value);
+
+    double getTriggerLevel() const;
+    void setTriggerLevel(double value);
+
+    void incT();
+protected:
+    virtual void paintEvent(QPaintEvent* e);
+};
+
+#endif // MSCOPEDRAWSURFACE_H
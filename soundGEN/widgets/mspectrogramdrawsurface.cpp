@@ -0,0 +1,136 @@
+#include "mspectrogramdrawsurface.h"
+
+MSpectrogramDrawSurface::MSpectrogramDrawSurface() :
+    QWidget()
+{
+    stft = new SndStft();
+    stft->addSubscriber(this);
+    image_column = 0;
+    channel = 0;
+    min_db = -100;
+    max_db = 0;
+    max_freq = 0;
+    initPalette();
+}
+
+MSpectrogramDrawSurface::~MSpectrogramDrawSurface()
+{
+    delete stft;
+}
+
+void MSpectrogramDrawSurface::initPalette()
+{
+    /* black -> blue -> red -> yellow -> white */
+    static const int stops[5][3] = {{0,0,0}, {0,0,200}, {220,0,0}, {255,220,0}, {255,255,255}};
+    int i, s;
+    double k;
+
+    palette.resize(256);
+    for(i = 0; i<256; i++) {
+        s = qMin(i/64, 3);
+        k = (i - s*64) / 64.0;
+        palette[i] = qRgb(stops[s][0] + k*(stops[s+1][0]-stops[s][0]),
+                          stops[s][1] + k*(stops[s+1][1]-stops[s][1]),
+                          stops[s][2] + k*(stops[s+1][2]-stops[s][2]));
+    }
+}
+
+void MSpectrogramDrawSurface::resetImage()
+{
+    if (width()<=0 || height()<=0) {
+        image = QImage();
+    } else {
+        image = QImage(width(), height(), QImage::Format_RGB32);
+        image.fill(palette.at(0));
+    }
+    image_column = 0;
+}
+
+unsigned int MSpectrogramDrawSurface::getChannel() const
+{
+    return channel;
+}
+
+void MSpectrogramDrawSurface::setChannel(unsigned int value)
+{
+    channel = value;
+    stft->reset();
+}
+
+double MSpectrogramDrawSurface::getMaxFreq() const
+{
+    return max_freq;
+}
+
+void MSpectrogramDrawSurface::setMaxFreq(double value)
+{
+    max_freq = value;
+}
+
+void MSpectrogramDrawSurface::incT()
+{
+    if (this->isHidden()) return;
+
+    SndController *sc = SndController::Instance();
+    if (!sc->running() || channel>=sc->getTap()->getChannelsCount()) return;
+
+    if (stft->getFrequency()!=sc->getFrequency()) {
+        stft->setFormat(2048, 512, sc->getFrequency());
+    }
+    stft->process(sc->getTap(), channel);
+}
+
+void MSpectrogramDrawSurface::stftFrame(quint32 position, const QVector<HarmonicInfo> *frame)
+{
+    Q_UNUSED(position);
+    if (image.isNull() || frame->isEmpty()) return;
+
+    int y, h = image.height();
+    unsigned int i, i_from, i_to, bins = frame->size();
+    const HarmonicInfo *bin = frame->constData();
+    double f1 = max_freq>0 ? max_freq : bin[bins-1].freq;
+    double bins_per_freq = bins/bin[bins-1].freq;
+    /* level of a full scale tone, so 0 dB is the top of the palette */
+    double full_scale = 0.5*stft->getPoints()/stft->getFrequency();
+    double amp, db;
+
+    for(y = 0; y<h; y++) {
+        i_from = qMin((unsigned int) ((h-y-1)*f1/h*bins_per_freq), bins-1);
+        i_to = qMin((unsigned int) ((h-y)*f1/h*bins_per_freq), bins-1);
+        amp = 0;
+        for(i = i_from; i<=i_to; i++) {
+            if (bin[i].amp>amp) amp = bin[i].amp;
+        }
+        db = amp>0 ? 20*log10(amp/full_scale) : min_db;
+        db = qBound(0.0, (db-min_db)/(max_db-min_db), 1.0);
+        ((QRgb*) image.scanLine(y))[image_column] = palette.at((int) (db*255));
+    }
+
+    image_column = (image_column+1) % image.width();
+}
+
+void MSpectrogramDrawSurface::paintEvent(QPaintEvent *e)
+{
+    QWidget::paintEvent(e);
+
+    if (this->isHidden()) return;
+    if (image.isNull()) return;
+
+    QPainter painter(this);
+    int w = image.width();
+
+    /* oldest column is the one written next */
+    painter.drawImage(0, 0, image, image_column, 0, w-image_column, image.height());
+    if (image_column>0) {
+        painter.drawImage(w-image_column, 0, image, 0, 0, image_column, image.height());
+    }
+
+    painter.setPen(Qt::black);
+    painter.drawRect(rect().left(),rect().top(),rect().right()-1,rect().bottom()-1);
+}
+
+void MSpectrogramDrawSurface::resizeEvent(QResizeEvent *e)
+{
+    QWidget::resizeEvent(e);
+    resetImage();
+}
@@ -0,0 +1,45 @@
+#ifndef MSPECTROGRAMDRAWSURFACE_H
+#define MSPECTROGRAMDRAWSURFACE_H
+
+#include <QWidget>
+#include <QPainter>
+#include <QImage>
+#include <math.h>
+#include "../sndcontroller.h"
+#include "../classes/sndstft.h"
+
+/*
+    Waterfall view of one rendered channel: every STFT frame becomes one image column.
+    The image is used as a ring of columns, so a new frame only writes one column
+    and painting blits the two parts of the ring in order.
+*/
+class MSpectrogramDrawSurface : public QWidget, public SndStftSubscriber
+{
+    Q_OBJECT
+private:
+    SndStft *stft;
+    QImage image;
+    QVector<QRgb> palette;
+    int image_column;
+    unsigned int channel;
+    double min_db, max_db;
+    double max_freq;
+    void initPalette();
+    void resetImage();
+public:
+    explicit MSpectrogramDrawSurface();
+    ~MSpectrogramDrawSurface();
+
+    unsigned int getChannel() const;
+    void setChannel(unsigned int value);
+    double getMaxFreq() const;
+    void setMaxFreq(double value);
+
+    void incT();
+    virtual void stftFrame(quint32 position, const QVector<HarmonicInfo> *frame);
+protected:
+    virtual void paintEvent(QPaintEvent* e);
+    virtual void resizeEvent(QResizeEvent* e);
+};
+
+#endif // MSPECTROGRAMDRAWSURFACE_H